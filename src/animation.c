@@ -62,6 +62,21 @@ int getAnimationKeyFrameIndex(Animation *animation, float stateTime) {
     return frameIndex;
 }
 
+//
+// Seconds from stateTime until the keyframe next changes, negative if it never will
+//
+float getAnimationTimeToNextFrame(const Animation *animation, float stateTime) {
+    assert(animation != NULL);
+
+    if (animation->numKeyFrames <= 1 || animation->frameDuration <= 0.f) return -1.f;
+
+    const unsigned int frame = (unsigned int) (stateTime / animation->frameDuration);
+    if ((animation->playMode == NORMAL || animation->playMode == REVERSED) && frame >= animation->numKeyFrames - 1) {
+        return -1.f;
+    }
+    return (float) (frame + 1) * animation->frameDuration - stateTime;
+}
+
 void destroyAnimation(Animation *animation) {
     assert(animation != NULL && animation->keyframes != NULL);
 
@@ -20,6 +20,7 @@ Animation *createAnimation(float frameDuration, unsigned int numKeyFrames, ...);
 Animation *createAnimationFromArray(float frameDuration, unsigned int numKeyFrames, TextureRegion *keyframes[]);
 TextureRegion *getAnimationKeyFrame(Animation *animation, float stateTime);
 int getAnimationKeyFrameIndex(Animation *animation, float stateTime);
+float getAnimationTimeToNextFrame(const Animation *animation, float stateTime);
 void destroyAnimation(Animation *animation);
 
 #endif //SERAPH_ANIMATION_H
@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include <SDL_log.h>
+#include <SDL_image.h>
 
 #include "json/json.h"
 
@@ -13,10 +14,11 @@
 const char *keyword_spritesheets = "spritesheets";
 const char *keyword_animations = "animations";
 
-void loadSpritesheets(Assets *assets, json_value *jsonValue, SDL_Renderer *renderer);
+void loadSpritesheets(Assets *assets, json_value *jsonValue);
 void loadAnimations(Assets *assets, json_value *jsonValue);
+void packKeyframes(Assets *assets, Renderer *renderer);
 
-Assets *loadAssets(const char *assetFilePath, SDL_Renderer *renderer) {
+Assets *loadAssets(const char *assetFilePath, Renderer *renderer) {
     assert(assetFilePath != NULL);
 
     char *assetsJson = readFileToString(assetFilePath);
@@ -39,7 +41,7 @@ Assets *loadAssets(const char *assetFilePath, SDL_Renderer *renderer) {
             json_value *propertyValue = rootJson->u.object.values[i].value;
 
             if (strcmp(propertyName, keyword_spritesheets) == 0) {
-                loadSpritesheets(assets, propertyValue, renderer);
+                loadSpritesheets(assets, propertyValue);
             }
             else if (strcmp(propertyName, keyword_animations) == 0) {
                 loadAnimations(assets, propertyValue);
@@ -51,10 +53,12 @@ Assets *loadAssets(const char *assetFilePath, SDL_Renderer *renderer) {
     }
     free(assetsJson);
 
+    packKeyframes(assets, renderer);
+
     return assets;
 }
 
-void loadSpritesheets(Assets *assets, json_value *jsonValue, SDL_Renderer *renderer) {
+void loadSpritesheets(Assets *assets, json_value *jsonValue) {
     assert(assets != NULL && jsonValue != NULL);
     assert(jsonValue->type == json_array);
 
@@ -68,6 +72,7 @@ void loadSpritesheets(Assets *assets, json_value *jsonValue, SDL_Renderer *rende
     }
 
     assets->spritesheets = (Texture **) calloc(numSpritesheets, sizeof(Texture *));
+    assets->spritesheetSurfaces = (SDL_Surface **) calloc(numSpritesheets, sizeof(SDL_Surface *));
     for (int i = 0; i < numSpritesheets; ++i) {
         json_value *sheetObject = jsonValue->u.array.values[i];
         assert(sheetObject->type == json_object);
@@ -85,8 +90,22 @@ void loadSpritesheets(Assets *assets, json_value *jsonValue, SDL_Renderer *rende
             }
         }
 
-        Texture *spritesheet = createTextureFromFile(renderer, name, path);
+        // Kept in a known format until the keyframes are packed
+        SDL_Surface *image = IMG_Load(path);
+        if (image == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to load image '%s': %s", path, IMG_GetError());
+            exit(1);
+        }
+        SDL_Surface *surface = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_ARGB8888, 0);
+        SDL_FreeSurface(image);
+        if (surface == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to convert image '%s': %s", path, SDL_GetError());
+            exit(1);
+        }
+
+        Texture *spritesheet = createTextureInfo(name, path, (unsigned int) surface->w, (unsigned int) surface->h);
         assets->spritesheets[i] = spritesheet;
+        assets->spritesheetSurfaces[i] = surface;
 
         SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "    Loaded spritesheet: '%s' @ '%s'", spritesheet->name, spritesheet->path);
     }
@@ -154,6 +173,70 @@ void loadAnimations(Assets *assets, json_value *jsonValue) {
     }
 }
 
+//
+// Pack the keyframes of every animation into the atlas, then point them at it
+//
+void packKeyframes(Assets *assets, Renderer *renderer) {
+    assert(assets != NULL);
+
+    size_t numKeyframes = 0;
+    for (int i = 0; i < assets->numAnimations; ++i) {
+        numKeyframes += assets->animations[i]->numKeyFrames;
+    }
+
+    // Keyframes shared between animations are packed once
+    AtlasRegion *regions = (AtlasRegion *) calloc(numKeyframes > 0 ? numKeyframes : 1, sizeof(AtlasRegion));
+    int *keyframeRegions = (int *) calloc(numKeyframes > 0 ? numKeyframes : 1, sizeof(int));
+    int numRegions = 0;
+    size_t keyframeIndex = 0;
+    for (int i = 0; i < assets->numAnimations; ++i) {
+        const Animation *animation = assets->animations[i];
+        for (int k = 0; k < animation->numKeyFrames; ++k, ++keyframeIndex) {
+            const TextureRegion *keyframe = animation->keyframes[k];
+
+            SDL_Surface *source = NULL;
+            for (int s = 0; s < assets->numSpritesheets; ++s) {
+                if (assets->spritesheets[s] == keyframe->texture) source = assets->spritesheetSurfaces[s];
+            }
+            assert(source != NULL);
+
+            int r = 0;
+            while (r < numRegions && !(regions[r].source == source && SDL_RectEquals(&regions[r].src, &keyframe->region))) {
+                r++;
+            }
+            if (r == numRegions) {
+                regions[numRegions++] = (AtlasRegion) { .source = source, .src = keyframe->region };
+            }
+            keyframeRegions[keyframeIndex] = r;
+        }
+    }
+
+    assets->atlas = createTextureAtlas(renderer, regions, numRegions);
+
+    keyframeIndex = 0;
+    for (int i = 0; i < assets->numAnimations; ++i) {
+        const Animation *animation = assets->animations[i];
+        for (int k = 0; k < animation->numKeyFrames; ++k, ++keyframeIndex) {
+            const AtlasRegion *region = &regions[keyframeRegions[keyframeIndex]];
+            TextureRegion *keyframe = animation->keyframes[k];
+            keyframe->texture = assets->atlas->pages[region->page];
+            keyframe->region  = region->packed;
+            keyframe->offsetX = region->trimmed.x - region->src.x;
+            keyframe->offsetY = region->trimmed.y - region->src.y;
+            keyframe->sourceW = region->src.w;
+            keyframe->sourceH = region->src.h;
+        }
+    }
+
+    free(regions);
+    free(keyframeRegions);
+    for (int s = 0; s < assets->numSpritesheets; ++s) {
+        SDL_FreeSurface(assets->spritesheetSurfaces[s]);
+    }
+    free(assets->spritesheetSurfaces);
+    assets->spritesheetSurfaces = NULL;
+}
+
 Texture *getSpritesheet(Assets *assets, const char *name) {
     assert(assets != NULL && name != NULL);
 
@@ -194,5 +277,6 @@ void destroyAssets(Assets *assets) {
         }
         free(assets->animations);
     }
+    destroyTextureAtlas(assets->atlas);
     free(assets);
 }
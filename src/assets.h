@@ -2,17 +2,22 @@
 #define SERAPH_ASSETS_H
 
 #include "texture.h"
+#include "texture_atlas.h"
 #include "animation.h"
 
+// Spritesheets aren't uploaded whole, the keyframes animations use are trimmed and packed into an atlas
+// so sprites from different sheets batch together. The spritesheets keep their details, not their pixels.
 typedef struct Assets {
     const char *path;
     size_t numSpritesheets;
     size_t numAnimations;
     Texture **spritesheets;
+    SDL_Surface **spritesheetSurfaces; // while loading
     Animation **animations;
+    TextureAtlas *atlas;
 } Assets;
 
-Assets *loadAssets(const char *assetFilePath, SDL_Renderer *renderer);
+Assets *loadAssets(const char *assetFilePath, Renderer *renderer);
 Texture *getSpritesheet(Assets *assets, const char *name);
 Animation *getAnimation(Assets *assets, const char *name);
 void destroyAssets(Assets *assets);
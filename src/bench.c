@@ -0,0 +1,130 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "common.h"
+#include "doom/doom_utils.h"
+
+Bench *createBench(const BenchOptions *options, int viewWidth, int viewHeight) {
+    assert(options != NULL && options->frames > 0);
+    assert(viewWidth > 0 && viewHeight > 0);
+
+    Bench *bench = (Bench *) calloc(1, sizeof(Bench));
+    bench->options = *options;
+    bench->options.dumpEvery = MAX(options->dumpEvery, 1);
+    bench->viewWidth = viewWidth;
+    bench->viewHeight = viewHeight;
+    bench->numFrames = 0;
+    bench->frameMicros = (uint64_t *) calloc((size_t) options->frames, sizeof(uint64_t));
+    bench->frameStats = (RendererStats *) calloc((size_t) options->frames, sizeof(RendererStats));
+    return bench;
+}
+
+//
+// Where the scripted path is at a frame. The view's center orbits the map while
+// it zooms smoothly from fitting the whole map, in to the nearest zoom and back.
+//
+void getBenchCamera(const Bench *bench, const short *mapBox, int frame, Camera *camera) {
+    assert(bench != NULL && mapBox != NULL && camera != NULL);
+
+    const int mapWidth  = mapBox[BOXRIGHT] - mapBox[BOXLEFT];
+    const int mapHeight = mapBox[BOXTOP]   - mapBox[BOXBOTTOM];
+    const double fitZoom = MIN((double) bench->viewWidth / MAX(mapWidth, 1), (double) bench->viewHeight / MAX(mapHeight, 1));
+    const double farZoom = MAX(CAMERA_MIN_ZOOM, MIN(fitZoom, BENCH_NEAR_ZOOM));
+
+    // Zooming at an even rate is geometric in the zoom
+    const double t = (double) frame / bench->options.frames;
+    const double out = SDL_fabs(1.0 - 2.0 * t); // 1 at the ends of the path, 0 halfway
+    const double zoom = BENCH_NEAR_ZOOM * SDL_pow(farZoom / BENCH_NEAR_ZOOM, out);
+
+    const double angle = 2.0 * M_PI * t;
+    const double centerX = mapBox[BOXLEFT]   + 0.5 * mapWidth  + 0.35 * mapWidth  * SDL_cos(angle);
+    const double centerY = mapBox[BOXBOTTOM] + 0.5 * mapHeight + 0.35 * mapHeight * SDL_sin(angle);
+    setCamera(camera, 0.f, 0.f, (float) zoom);
+    centerCamera(camera, (float) centerX, (float) centerY, bench->viewWidth, bench->viewHeight);
+}
+
+//
+// Record a frame's time and what the renderer drew for its last presented frame
+//
+void recordBenchFrame(Bench *bench, uint64_t micros, const Renderer *renderer) {
+    assert(bench != NULL && renderer != NULL);
+    if (bench->numFrames >= bench->options.frames) return;
+
+    bench->frameMicros[bench->numFrames] = micros;
+    bench->frameStats[bench->numFrames] = renderer->lastFrame;
+    bench->numFrames++;
+}
+
+//
+// Save the presented frame as a BMP, if frames are being dumped and this is one of them
+//
+void dumpBenchFrame(const Bench *bench, const Renderer *renderer, int frame) {
+    assert(bench != NULL && renderer != NULL);
+    if (bench->options.dumpDir == NULL || frame % bench->options.dumpEvery != 0) return;
+    if (renderer->framebuffer == NULL) return;
+
+    char path[1024];
+    SDL_snprintf(path, sizeof(path), "%s/frame_%05d.bmp", bench->options.dumpDir, frame);
+    if (SDL_SaveBMP(renderer->framebuffer, path) != 0) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Failed to dump frame to '%s': %s", path, SDL_GetError());
+    }
+}
+
+static int compareMicros(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a;
+    const uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentile of sorted frame times, in milliseconds
+static double getPercentile(const uint64_t *sorted, int count, int percent) {
+    const int rank = (percent * count + 99) / 100;
+    return (double) sorted[MAX(rank, 1) - 1] / 1000.0;
+}
+
+void reportBench(const Bench *bench, const char *mapName, FILE *out) {
+    assert(bench != NULL && out != NULL);
+
+    const int count = bench->numFrames;
+    if (count == 0) {
+        fprintf(out, "Bench: no frames recorded\n");
+        return;
+    }
+
+    uint64_t *sorted = (uint64_t *) malloc((size_t) count * sizeof(uint64_t));
+    SDL_memcpy(sorted, bench->frameMicros, (size_t) count * sizeof(uint64_t));
+    qsort(sorted, (size_t) count, sizeof(uint64_t), compareMicros);
+
+    uint64_t totalMicros = 0;
+    RendererStats total = { 0 };
+    int maxDrawCalls = 0;
+    for (int i = 0; i < count; ++i) {
+        const RendererStats stats = bench->frameStats[i];
+        totalMicros += bench->frameMicros[i];
+        total.drawCalls += stats.drawCalls;
+        total.lines     += stats.lines;
+        total.rects     += stats.rects;
+        total.copies    += stats.copies;
+        total.triangles += stats.triangles;
+        maxDrawCalls = MAX(maxDrawCalls, stats.drawCalls);
+    }
+
+    const double meanMillis = (double) totalMicros / count / 1000.0;
+    fprintf(out, "Bench: %s, %d frames at %dx%d\n", mapName, count, bench->viewWidth, bench->viewHeight);
+    fprintf(out, "Frame time: mean %.3f ms (%.1f fps), p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n",
+            meanMillis, (meanMillis > 0.0) ? 1000.0 / meanMillis : 0.0,
+            getPercentile(sorted, count, 50), getPercentile(sorted, count, 90),
+            getPercentile(sorted, count, 99), (double) sorted[count - 1] / 1000.0);
+    fprintf(out, "Per frame: %.1f draw calls (max %d), %.1f lines, %.1f rects, %.1f copies, %.1f triangles\n",
+            (double) total.drawCalls / count, maxDrawCalls, (double) total.lines / count,
+            (double) total.rects / count, (double) total.copies / count, (double) total.triangles / count);
+    free(sorted);
+}
+
+void destroyBench(Bench *bench) {
+    if (bench == NULL) return;
+    free(bench->frameMicros);
+    free(bench->frameStats);
+    free(bench);
+}
@@ -0,0 +1,40 @@
+#ifndef SERAPH_BENCH_H
+#define SERAPH_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "camera.h"
+#include "renderer.h"
+
+#define BENCH_DEFAULT_FRAMES 600
+// Animations advance this much a frame, so every run draws the same frames
+#define BENCH_FRAME_TIME (1.0 / 60.0)
+// The path zooms between fitting the whole map and this, in pixels per map unit
+#define BENCH_NEAR_ZOOM 1.f
+
+typedef struct BenchOptions {
+    const char *mapName; // NULL for the WAD's first map
+    int frames;
+    const char *dumpDir; // NULL to not dump frames
+    int dumpEvery;       // dump every nth frame
+} BenchOptions;
+
+// Frame times and draw counts of a scripted run, one orbit of the map zooming in and back out
+typedef struct Bench {
+    BenchOptions options;
+    int viewWidth;
+    int viewHeight;
+    int numFrames;
+    uint64_t *frameMicros;
+    RendererStats *frameStats;
+} Bench;
+
+Bench *createBench(const BenchOptions *options, int viewWidth, int viewHeight);
+void getBenchCamera(const Bench *bench, const short *mapBox, int frame, Camera *camera);
+void recordBenchFrame(Bench *bench, uint64_t micros, const Renderer *renderer);
+void dumpBenchFrame(const Bench *bench, const Renderer *renderer, int frame);
+void reportBench(const Bench *bench, const char *mapName, FILE *out);
+void destroyBench(Bench *bench);
+
+#endif //SERAPH_BENCH_H
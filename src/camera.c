@@ -0,0 +1,112 @@
+#include <assert.h>
+
+#include "camera.h"
+#include "common.h"
+
+#ifdef SERAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+//
+// Move and zoom the camera, recaching its transform
+//
+void setCamera(Camera *camera, float x, float y, float zoom) {
+    assert(camera != NULL);
+
+    camera->zoom = MAX(CAMERA_MIN_ZOOM, MIN(zoom, CAMERA_MAX_ZOOM));
+    camera->x = x;
+    camera->y = y;
+    camera->offsetX = -x * camera->zoom;
+    camera->offsetY = -y * camera->zoom;
+    camera->inverseZoom = 1.f / camera->zoom;
+}
+
+//
+// Move the view by a distance in pixels
+//
+void panCamera(Camera *camera, float dx, float dy) {
+    assert(camera != NULL);
+
+    setCamera(camera, camera->x + dx * camera->inverseZoom, camera->y + dy * camera->inverseZoom, camera->zoom);
+}
+
+//
+// Zoom by a factor, keeping the map point under a screen position where it is
+//
+void zoomCameraAt(Camera *camera, float factor, float screenX, float screenY) {
+    assert(camera != NULL && factor > 0.f);
+
+    const float worldX = screenX * camera->inverseZoom + camera->x;
+    const float worldY = screenY * camera->inverseZoom + camera->y;
+    const float zoom = MAX(CAMERA_MIN_ZOOM, MIN(camera->zoom * factor, CAMERA_MAX_ZOOM));
+    setCamera(camera, worldX - screenX / zoom, worldY - screenY / zoom, zoom);
+}
+
+//
+// Move the view so a map point is in the middle of it
+//
+void centerCamera(Camera *camera, float worldX, float worldY, int viewWidth, int viewHeight) {
+    assert(camera != NULL);
+
+    setCamera(camera, worldX - 0.5f * (float) viewWidth * camera->inverseZoom,
+              worldY - 0.5f * (float) viewHeight * camera->inverseZoom, camera->zoom);
+}
+
+//
+// The camera part of the way from one to another, alpha from 0 to 1
+//
+Camera lerpCamera(const Camera *from, const Camera *to, double alpha) {
+    assert(from != NULL && to != NULL);
+
+    const float t = (float) alpha;
+    Camera camera;
+    setCamera(&camera, from->x + (to->x - from->x) * t, from->y + (to->y - from->y) * t,
+              from->zoom + (to->zoom - from->zoom) * t);
+    return camera;
+}
+
+bool cameraEquals(const Camera *a, const Camera *b) {
+    assert(a != NULL && b != NULL);
+    return a->x == b->x && a->y == b->y && a->zoom == b->zoom;
+}
+
+//
+// Map points to screen positions, out may be in
+//
+void worldToScreen(const Camera *camera, const float *x, const float *y, int count, float *outX, float *outY) {
+    assert(camera != NULL);
+    transformPoints(x, y, count, camera->zoom, camera->offsetX, camera->offsetY, outX, outY);
+}
+
+//
+// Screen positions to map points, out may be in
+//
+void screenToWorld(const Camera *camera, const float *x, const float *y, int count, float *outX, float *outY) {
+    assert(camera != NULL);
+    transformPoints(x, y, count, camera->inverseZoom, camera->x, camera->y, outX, outY);
+}
+
+//
+// Transform a batch of points, out = in * scale + offset,
+// in place is fine since every point is read before it's written
+//
+void transformPoints(const float *x, const float *y, int count,
+                     float scale, float offsetX, float offsetY,
+                     float *outX, float *outY) {
+    assert(count == 0 || (x != NULL && y != NULL && outX != NULL && outY != NULL));
+
+    int i = 0;
+#ifdef SERAPH_SSE2
+    const __m128 scale4 = _mm_set1_ps(scale);
+    const __m128 offsetX4 = _mm_set1_ps(offsetX);
+    const __m128 offsetY4 = _mm_set1_ps(offsetY);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(&outX[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&x[i]), scale4), offsetX4));
+        _mm_storeu_ps(&outY[i], _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&y[i]), scale4), offsetY4));
+    }
+#endif
+    for (; i < count; ++i) {
+        outX[i] = x[i] * scale + offsetX;
+        outY[i] = y[i] * scale + offsetY;
+    }
+}
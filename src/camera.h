@@ -1,9 +1,37 @@
 #ifndef SERAPH_CAMERA_H
 #define SERAPH_CAMERA_H
 
-typedef struct {
-    int x;
-    int y;
+#include <stdbool.h>
+
+// Zoom in pixels per map unit, each wheel notch or key press zooms by a step
+#define CAMERA_MIN_ZOOM (1.f / 16.f)
+#define CAMERA_MAX_ZOOM 4.f
+#define CAMERA_ZOOM_STEP 1.189207f // 2^(1/4), four steps double the zoom
+
+// A view over the map. Its position is the map point at the view's top left, and the
+// world to screen transform, screen = world * zoom + offset, is cached from it so every
+// point costs a multiply-add. Change it through the functions below to keep that up to date.
+typedef struct Camera {
+    float x;
+    float y;
+    float zoom;
+    // Cached transform
+    float offsetX;
+    float offsetY;
+    float inverseZoom;
 } Camera;
 
+void setCamera(Camera *camera, float x, float y, float zoom);
+void panCamera(Camera *camera, float dx, float dy);
+void zoomCameraAt(Camera *camera, float factor, float screenX, float screenY);
+void centerCamera(Camera *camera, float worldX, float worldY, int viewWidth, int viewHeight);
+Camera lerpCamera(const Camera *from, const Camera *to, double alpha);
+bool cameraEquals(const Camera *a, const Camera *b);
+
+void worldToScreen(const Camera *camera, const float *x, const float *y, int count, float *outX, float *outY);
+void screenToWorld(const Camera *camera, const float *x, const float *y, int count, float *outX, float *outY);
+void transformPoints(const float *x, const float *y, int count,
+                     float scale, float offsetX, float offsetY,
+                     float *outX, float *outY);
+
 #endif
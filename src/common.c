@@ -1,7 +1,24 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <errno.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "SDL_log.h"
+#include "SDL_timer.h"
+
+#include "common.h"
 
 char *readFileToString(const char *path) {
     FILE *file = fopen(path, "r");
@@ -29,3 +46,135 @@ char *readFileToString(const char *path) {
 
     return buffer;
 }
+
+uint64_t getMicroseconds() {
+    const Uint64 counter = SDL_GetPerformanceCounter();
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    // Split the conversion so the multiply can't overflow
+    return (counter / frequency) * 1000000 + (counter % frequency) * 1000000 / frequency;
+}
+
+//
+// Allocate zeroed memory aligned to a power of two,
+// must be released with freeAligned()
+//
+void *allocAligned(size_t alignment, size_t size) {
+    void *memory = NULL;
+#ifdef _WIN32
+    memory = _aligned_malloc(size, alignment);
+#else
+    if (posix_memalign(&memory, alignment, size) != 0) {
+        memory = NULL;
+    }
+#endif
+    if (memory == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to allocate %lu bytes", (unsigned long) size);
+        exit(1);
+    }
+    memset(memory, 0, size);
+    return memory;
+}
+
+void freeAligned(void *memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+//
+// Map a whole file into memory, either read-only or copy-on-write,
+// where writes stay private to this process and never reach the file.
+// Missing files fail quietly so callers can treat them as optional.
+//
+static MappedFile *mapFileWithAccess(const char *path, bool copyOnWrite) {
+    MappedFile *mappedFile = (MappedFile *) calloc(1, sizeof(MappedFile));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        if (GetLastError() != ERROR_FILE_NOT_FOUND && GetLastError() != ERROR_PATH_NOT_FOUND) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open '%s', error: %lu", path, GetLastError());
+        }
+        free(mappedFile);
+        return NULL;
+    }
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    mappedFile->size = (size_t) fileSize.QuadPart;
+
+    // Zero length files can't be mapped, but are still valid (empty) views
+    if (mappedFile->size != 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            mappedFile->data = (const unsigned char *) MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+        if (mappedFile->data == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to map '%s', error: %lu", path, GetLastError());
+            CloseHandle(file);
+            free(mappedFile);
+            return NULL;
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open '%s', error: %s", path, strerror(errno));
+        }
+        free(mappedFile);
+        return NULL;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to stat '%s', error: %s", path, strerror(errno));
+        close(fd);
+        free(mappedFile);
+        return NULL;
+    }
+    mappedFile->size = (size_t) fileStat.st_size;
+
+    // Zero length files can't be mapped, but are still valid (empty) views
+    if (mappedFile->size != 0) {
+        const int protection = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        void *data = mmap(NULL, mappedFile->size, protection, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to map '%s', error: %s", path, strerror(errno));
+            close(fd);
+            free(mappedFile);
+            return NULL;
+        }
+        mappedFile->data = (const unsigned char *) data;
+    }
+    close(fd);
+#endif
+
+    mappedFile->path = strdup(path);
+    return mappedFile;
+}
+
+MappedFile *mapFile(const char *path) {
+    return mapFileWithAccess(path, false);
+}
+
+MappedFile *mapFileCopyOnWrite(const char *path) {
+    return mapFileWithAccess(path, true);
+}
+
+void unmapFile(MappedFile *mappedFile) {
+    if (mappedFile == NULL) return;
+    if (mappedFile->data != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(mappedFile->data);
+#else
+        munmap((void *) mappedFile->data, mappedFile->size);
+#endif
+    }
+    free((char *) mappedFile->path);
+    free(mappedFile);
+}
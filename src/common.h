@@ -4,6 +4,30 @@
 #define MIN(x, y) (((x) < (y) ? (x) : (y)))
 #define MAX(x, y) (((x) > (y) ? (x) : (y)))
 
+// SSE2 is always there on x86-64, and on 32-bit x86 when the compiler targets it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERAPH_SSE2 1
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A view of an entire file mapped into memory,
+// data is only writable when mapped copy-on-write
+typedef struct MappedFile {
+    const char *path;
+    size_t size;
+    const unsigned char *data;
+} MappedFile;
+
 char *readFileToString(const char *path);
+uint64_t getMicroseconds();
+
+void *allocAligned(size_t alignment, size_t size);
+void freeAligned(void *memory);
+
+MappedFile *mapFile(const char *path);
+MappedFile *mapFileCopyOnWrite(const char *path);
+void unmapFile(MappedFile *mappedFile);
 
 #endif //SERAPH_COMMON_H
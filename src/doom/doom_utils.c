@@ -1,241 +1,666 @@
-#include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <limits.h>
 
 #include "doom_utils.h"
+#include "map_cache_file.h"
+#include "map_lod.h"
+#include "../log.h"
+
+#ifdef SERAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+// Alignment of the map arena and of every array carved out of it
+#define MAP_ARENA_ALIGNMENT 64
+#define ALIGN_MAP_ARENA(size) (((size) + MAP_ARENA_ALIGNMENT - 1) & ~((size_t) MAP_ARENA_ALIGNMENT - 1))
+
+static const size_t mapLumpRecordSizes[NUM_MAP_LUMPS] = {
+        0,
+        sizeof(mapthing_t),
+        sizeof(linedef_t),
+        sizeof(sidedef_t),
+        sizeof(mapvertex_t),
+        sizeof(mapseg_t),
+        sizeof(mapsubsector_t),
+        sizeof(mapnode_t),
+        sizeof(mapsector_t),
+        sizeof(unsigned char), // REJECT bit matrix
+        sizeof(short)          // BLOCKMAP header, offsets and blocklists
+};
+
+// Every array carved out of the map arena, used to relocate and validate map cache files
+typedef struct {
+    size_t pointerOffset;
+    size_t countOffset;
+    size_t recordSize;
+} maparray_t;
+
+#define MAP_ARRAY(field, count, type) { offsetof(map_t, field), offsetof(map_t, count), sizeof(type) }
+static const maparray_t mapArrays[] = {
+        MAP_ARRAY(things,        numThings,     mapthing_t),
+        MAP_ARRAY(linedefs,      numLinedefs,   linedef_t),
+        MAP_ARRAY(sidedefs,      numSidedefs,   sidedef_t),
+        MAP_ARRAY(vertices,      numVertexes,   mapvertex_t),
+        MAP_ARRAY(segs,          numSegs,       mapseg_t),
+        MAP_ARRAY(subsectors,    numSubsectors, mapsubsector_t),
+        MAP_ARRAY(nodes,         numNodes,      mapnode_t),
+        MAP_ARRAY(sectors,       numSectors,    mapsector_t),
+        MAP_ARRAY(reject,        rejectSize,    unsigned char),
+        MAP_ARRAY(blockmap,      blockmapSize,  short),
+        MAP_ARRAY(vertexX,       numVertexes,   float),
+        MAP_ARRAY(vertexY,       numVertexes,   float),
+        MAP_ARRAY(thingX,        numThings,     float),
+        MAP_ARRAY(thingY,        numThings,     float),
+        MAP_ARRAY(linedefBounds, numLinedefs,   mapbbox_t),
+        MAP_ARRAY(linedefClasses, numLinedefs,  unsigned char),
+        MAP_ARRAY(thingsByClass, numThings,     int),
+        MAP_ARRAY(lodLines[0],   numLodLines[0], mapline_t),
+        MAP_ARRAY(lodLines[1],   numLodLines[1], mapline_t),
+        MAP_ARRAY(lodLines[2],   numLodLines[2], mapline_t),
+        MAP_ARRAY(lodBounds[0],  numLodLines[0], mapbbox_t),
+        MAP_ARRAY(lodBounds[1],  numLodLines[1], mapbbox_t),
+        MAP_ARRAY(lodBounds[2],  numLodLines[2], mapbbox_t),
+};
+#define NUM_MAP_ARRAYS (sizeof(mapArrays) / sizeof(mapArrays[0]))
+
+// Map lumps are copied straight into these, so they must match the on-disk record sizes
+typedef char assertThingSize[sizeof(mapthing_t) == 10 ? 1 : -1];
+typedef char assertLinedefSize[sizeof(linedef_t) == 14 ? 1 : -1];
+typedef char assertSidedefSize[sizeof(sidedef_t) == 30 ? 1 : -1];
+typedef char assertVertexSize[sizeof(mapvertex_t) == 4 ? 1 : -1];
+typedef char assertSegSize[sizeof(mapseg_t) == 12 ? 1 : -1];
+typedef char assertSubsectorSize[sizeof(mapsubsector_t) == 4 ? 1 : -1];
+typedef char assertNodeSize[sizeof(mapnode_t) == 28 ? 1 : -1];
+typedef char assertSectorSize[sizeof(mapsector_t) == 26 ? 1 : -1];
+
+// mapArrays lists the lines and bounds of each LOD level
+typedef char assertLodLevels[MAP_LOD_LEVELS == 3 ? 1 : -1];
 
 //
-// Dynamic array helpers
+// Populate the mapLumps view from the specified WAD's directory index
 //
-maplumps_t *initMapLumps(int initialSize) {
-    maplumps_t *maplumps = (maplumps_t *) calloc(1, sizeof(maplumps_t));
-    maplumps->lumps = (filelump_t *) calloc((size_t) initialSize, sizeof(filelump_t));
-    maplumps->count = 0;
-    maplumps->capacity = initialSize;
-    return maplumps;
-}
+void readWadMaps(const wad_t *wad, maplumps_t *mapLumps) {
+    assert(wad != NULL && mapLumps != NULL);
 
-void insertMapLump(maplumps_t *maplumps, filelump_t *lump) {
-    if (maplumps->count == maplumps->capacity) {
-        maplumps->capacity *= 2;
-        maplumps->lumps = (filelump_t *) realloc(maplumps->lumps, maplumps->capacity * sizeof(filelump_t));
+    mapLumps->count = wad->numMaps;
+    mapLumps->maps = wad->maps;
+
+    for (int i = 0; i < mapLumps->count; ++i) {
+        const filelump_t *lump = &wad->directory[mapLumps->maps[i].lumps[LUMP_LABEL]];
+        LOG_DEBUG("Map %4d: %8.*s, offset @ 0x%x (%d bytes)",
+                  mapLumps->maps[i].lumps[LUMP_LABEL], 8, lump->name, lump->filePos, lump->filePos);
     }
-    maplumps->lumps[maplumps->count] = *lump;
-    maplumps->count++;
+    LOG_INFO("Loaded %d map label lumps.", mapLumps->count);
 }
 
-void freeMapLumps(maplumps_t *maplumps) {
-    free(maplumps->lumps);
-    maplumps->lumps = NULL;
-    maplumps->count = 0;
-    maplumps->capacity = 0;
+//
+// Get a view of the specified map lump and the number of whole records in it,
+// returns false if the lump is missing or out of bounds
+//
+static bool getMapLumpView(const wad_t *wad, const wadmap_t *wadmap, MapLevelType type, lumpview_t *view, int *count) {
+    *count = 0;
+
+    if (!getWadLumpView(wad, wadmap->lumps[type], view)) {
+        LOG_WARN("Missing lump: '%s' in map %s", getMapLumpName(type), wadmap->name);
+        return false;
+    }
+
+    const size_t recordSize = mapLumpRecordSizes[type];
+    if (view->size % recordSize != 0) {
+        LOG_WARN("Lump '%s' in map %s is %lu bytes, not a multiple of its %lu byte records",
+                 getMapLumpName(type), wadmap->name, (unsigned long) view->size, (unsigned long) recordSize);
+    }
+
+    *count = (int) (view->size / recordSize);
+    return true;
 }
 
 //
-// Loading helper functions
+// Point linedefs with out of range vertices at vertex 0 and drop their out of range sidedefs,
+// so nothing downstream needs to check
 //
-bool isLumpMapLabel(filelump_t *lump) {
-    assert(lump != NULL);
-    // ExMx
-    bool isDoom1MapLabelLump = (lump->name[0] == 'E' && lump->name[2] == 'M'
-                             && lump->name[1] >= '1' && lump->name[1] <= '9'
-                             && lump->name[3] >= '1' && lump->name[3] <= '9');
-    // MAPxx
-    bool isDoom2MapLabelLump = (lump->name[0] == 'M' && lump->name[1] == 'A' && lump->name[2] == 'P'
-                             && lump->name[3] >= '1' && lump->name[3] <= '9'
-                             && lump->name[4] >= '1' && lump->name[4] <= '9');
-    return isDoom1MapLabelLump || isDoom2MapLabelLump;
+static void validateLinedefs(map_t *map, const char *name) {
+    if (map->numVertexes == 0) {
+        if (map->numLinedefs > 0) {
+            LOG_WARN("Map %s has %d linedefs but no vertices, ignoring them", name, map->numLinedefs);
+            map->numLinedefs = 0;
+        }
+        return;
+    }
+
+    int numInvalid = 0;
+    int numInvalidSides = 0;
+    for (int i = 0; i < map->numLinedefs; ++i) {
+        linedef_t *line = &map->linedefs[i];
+        if ((unsigned short) line->v1 >= map->numVertexes) { line->v1 = 0; ++numInvalid; }
+        if ((unsigned short) line->v2 >= map->numVertexes) { line->v2 = 0; ++numInvalid; }
+        for (int side = 0; side < 2; ++side) {
+            if (line->sideNum[side] != -1 && (unsigned short) line->sideNum[side] >= map->numSidedefs) {
+                line->sideNum[side] = -1;
+                ++numInvalidSides;
+            }
+        }
+    }
+    if (numInvalid > 0) {
+        LOG_WARN("Map %s has %d linedef vertex references out of range", name, numInvalid);
+    }
+    if (numInvalidSides > 0) {
+        LOG_WARN("Map %s has %d linedef sidedef references out of range", name, numInvalidSides);
+    }
 }
 
 //
-// Read the specified WAD to populate the mapLumps struct
+// The first thing stopping the segs, subsectors and nodes forming a tree
+// that can be walked without further checks, or NULL if there's nothing
 //
-void readWadMaps(const char *wadFileName, maplumps_t *mapLumps) {
-    FILE *wadFile = fopen(wadFileName, "rb");
-    assert(wadFile != NULL);
-    {
-        // Read and validate wadinfo
-        wadinfo_t wadinfo;
-        fread(&wadinfo, sizeof(wadinfo_t), 1, wadFile);
+static const char *findMapBspProblem(const map_t *map) {
+    const char *problem = NULL;
+    for (int i = 0; i < map->numSegs && problem == NULL; ++i) {
+        const mapseg_t *seg = &map->segs[i];
+        if ((unsigned short) seg->v1 >= map->numVertexes || (unsigned short) seg->v2 >= map->numVertexes) {
+            problem = "seg vertex out of range";
+        } else if ((unsigned short) seg->linedef >= map->numLinedefs || (seg->side != 0 && seg->side != 1)) {
+            problem = "seg linedef out of range";
+        }
+    }
+    for (int i = 0; i < map->numSubsectors && problem == NULL; ++i) {
+        const mapsubsector_t *subsector = &map->subsectors[i];
+        if ((unsigned short) subsector->firstSeg + (unsigned short) subsector->numSegs > map->numSegs) {
+            problem = "subsector segs out of range";
+        }
+    }
 
-        if (strncmp(wadinfo.identification, "IWAD", 4) != 0
-         && strncmp(wadinfo.identification, "PWAD", 4) != 0) {
-            printf("\nInvalid WAD info: identification '%.*s'", 4, wadinfo.identification);
-            fclose(wadFile);
-            return;
+    // Every node and subsector is the child of one node, and nodes come after their children
+    unsigned char *referenced = (unsigned char *) calloc((size_t) map->numNodes + map->numSubsectors + 1, 1);
+    for (int i = 0; i < map->numNodes && problem == NULL; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            const int child = map->nodes[i].children[side];
+            const int index = (child & NF_SUBSECTOR) ? map->numNodes + (child & ~NF_SUBSECTOR) : child;
+            if ((child & NF_SUBSECTOR) ? (child & ~NF_SUBSECTOR) >= map->numSubsectors : child >= i) {
+                problem = "node child out of range";
+            } else if (referenced[index]++) {
+                problem = "node child shared";
+            }
         }
+    }
+    free(referenced);
 
-        printf("\n%s - %.*s, %d lumps, dictionary @ %x (%d bytes)\n",
-               wadFileName, 4, wadinfo.identification, wadinfo.numLumps,
-               wadinfo.infoTableOffset, wadinfo.infoTableOffset);
+    if (problem == NULL && map->numNodes == 0 && map->numSubsectors > 1) {
+        problem = "subsectors without nodes";
+    }
+    return problem;
+}
 
-        // Read in lumps, storing map lumps
-        fseek(wadFile, wadinfo.infoTableOffset, SEEK_SET);
-        for (int i = 0; i < wadinfo.numLumps; ++i) {
-            filelump_t lump;
-            fread(&lump, sizeof(filelump_t), 1, wadFile);
+//
+// Check the map's BSP, a map with a broken one is left without it
+//
+static void validateMapBsp(map_t *map, const char *name) {
+    const char *problem = findMapBspProblem(map);
+    if (problem != NULL) {
+        LOG_WARN("Map %s has an invalid BSP (%s), drawing without it", name, problem);
+        map->numNodes = 0;
+        map->numSubsectors = 0;
+    }
+}
 
-            if (isLumpMapLabel(&lump)) {
-                insertMapLump(mapLumps, &lump);
-                printf("Map %4d: %8.*s, %5d bytes, offset @ 0x%x (%d bytes)\n",
-                       i, 8, lump.name, lump.size, lump.filePos, lump.filePos);
-            } else {
-                // Non-map-label lump
-                printf("Lump %4d: %8.*s, %5d bytes, offset @ 0x%x (%d bytes)\n",
-                       i, 8, lump.name, lump.size, lump.filePos, lump.filePos);
-            }
-        }
-        printf("\nLoaded %d map label lumps.\n", mapLumps->count);
+//
+// Unpack the vertex and thing positions into the map's float x[] and y[] arrays,
+// and take the map's bounds in the same pass over the vertices
+//
+static void decodeMapPositions(map_t *map) {
+    int minX = SHRT_MAX, minY = SHRT_MAX;
+    int maxX = SHRT_MIN, maxY = SHRT_MIN;
+
+    int i = 0;
+#ifdef SERAPH_SSE2
+    // Four vertices are four little-endian 32-bit lanes of (y << 16 | x),
+    // sign extend each half with a shift pair and convert in place.
+    // As 16-bit lanes they're x,y pairs, so min/max of the packed lanes track both axes at once.
+    __m128i minXY = _mm_set1_epi16(SHRT_MAX);
+    __m128i maxXY = _mm_set1_epi16(SHRT_MIN);
+    for (; i + 4 <= map->numVertexes; i += 4) {
+        const __m128i packed = _mm_loadu_si128((const __m128i *) &map->vertices[i]);
+        const __m128i x = _mm_srai_epi32(_mm_slli_epi32(packed, 16), 16);
+        const __m128i y = _mm_srai_epi32(packed, 16);
+        _mm_store_ps(&map->vertexX[i], _mm_cvtepi32_ps(x));
+        _mm_store_ps(&map->vertexY[i], _mm_cvtepi32_ps(y));
+        minXY = _mm_min_epi16(minXY, packed);
+        maxXY = _mm_max_epi16(maxXY, packed);
     }
-    fclose(wadFile);
+
+    short mins[8], maxs[8];
+    _mm_storeu_si128((__m128i *) mins, minXY);
+    _mm_storeu_si128((__m128i *) maxs, maxXY);
+    for (int lane = 0; lane < 8; lane += 2) {
+        minX = MIN(minX, mins[lane]); minY = MIN(minY, mins[lane + 1]);
+        maxX = MAX(maxX, maxs[lane]); maxY = MAX(maxY, maxs[lane + 1]);
+    }
+#endif
+    for (; i < map->numVertexes; ++i) {
+        const mapvertex_t vertex = map->vertices[i];
+        map->vertexX[i] = (float) vertex.x;
+        map->vertexY[i] = (float) vertex.y;
+        minX = MIN(minX, vertex.x); minY = MIN(minY, vertex.y);
+        maxX = MAX(maxX, vertex.x); maxY = MAX(maxY, vertex.y);
+    }
+
+    map->bounds.box[BOXTOP]    = (short) maxY;
+    map->bounds.box[BOXBOTTOM] = (short) minY;
+    map->bounds.box[BOXLEFT]   = (short) minX;
+    map->bounds.box[BOXRIGHT]  = (short) maxX;
+
+    // Things are 10 byte records, there are few enough of them that a strided scalar pass does fine
+    for (i = 0; i < map->numThings; ++i) {
+        map->thingX[i] = (float) map->things[i].x;
+        map->thingY[i] = (float) map->things[i].y;
+    }
+}
+
+#ifdef SERAPH_SSE2
+static inline int32_t loadPackedVertex(const mapvertex_t *vertex) {
+    int32_t packed;
+    memcpy(&packed, vertex, sizeof(packed));
+    return packed;
 }
+#endif
 
 //
-// Read the specified WAD to load the map specified by mapLabel
+// Take the bounds of every linedef from its vertices
 //
-void loadWadMap(const char *wadFileName, filelump_t *mapLabel, map_t *map) {
-    assert(mapLabel != NULL && map != NULL);
-    map->label = *mapLabel;
+static void computeLinedefBounds(map_t *map) {
+    const mapvertex_t *vertices = map->vertices;
 
-    FILE *wadFile = fopen(wadFileName, "rb");
-    assert(wadFile != NULL);
-    {
-        // Read and validate wadinfo
-        wadinfo_t wadinfo;
-        fread(&wadinfo, sizeof(wadinfo_t), 1, wadFile);
+    int i = 0;
+#ifdef SERAPH_SSE2
+    // Gather four linedefs' packed vertices, min/max them as x,y pairs,
+    // then interleave and shuffle each (minX, minY, maxX, maxY) into bbox order
+#define BOX_ORDER _MM_SHUFFLE(2, 0, 1, 3)
+    for (; i + 4 <= map->numLinedefs; i += 4) {
+        const linedef_t *lines = &map->linedefs[i];
+        const __m128i v1 = _mm_set_epi32(loadPackedVertex(&vertices[(unsigned short) lines[3].v1]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[2].v1]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[1].v1]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[0].v1]));
+        const __m128i v2 = _mm_set_epi32(loadPackedVertex(&vertices[(unsigned short) lines[3].v2]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[2].v2]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[1].v2]),
+                                         loadPackedVertex(&vertices[(unsigned short) lines[0].v2]));
+        const __m128i mins = _mm_min_epi16(v1, v2);
+        const __m128i maxs = _mm_max_epi16(v1, v2);
+        __m128i boxes01 = _mm_unpacklo_epi32(mins, maxs);
+        __m128i boxes23 = _mm_unpackhi_epi32(mins, maxs);
+        boxes01 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(boxes01, BOX_ORDER), BOX_ORDER);
+        boxes23 = _mm_shufflehi_epi16(_mm_shufflelo_epi16(boxes23, BOX_ORDER), BOX_ORDER);
+        _mm_store_si128((__m128i *) &map->linedefBounds[i], boxes01);
+        _mm_store_si128((__m128i *) &map->linedefBounds[i + 2], boxes23);
+    }
+#undef BOX_ORDER
+#endif
+    for (; i < map->numLinedefs; ++i) {
+        const mapvertex_t v1 = vertices[(unsigned short) map->linedefs[i].v1];
+        const mapvertex_t v2 = vertices[(unsigned short) map->linedefs[i].v2];
+        short *box = map->linedefBounds[i].box;
+        box[BOXTOP]    = MAX(v1.y, v2.y);
+        box[BOXBOTTOM] = MIN(v1.y, v2.y);
+        box[BOXLEFT]   = MIN(v1.x, v2.x);
+        box[BOXRIGHT]  = MAX(v1.x, v2.x);
+    }
+}
 
-        if (strncmp(wadinfo.identification, "IWAD", 4) != 0
-         && strncmp(wadinfo.identification, "PWAD", 4) != 0) {
-            printf("\nInvalid WAD info: identification '%.*s'", 4, wadinfo.identification);
-            fclose(wadFile);
-            return;
+//
+// Classify the linedefs for drawing, and counting sort the things by class
+//
+static void classifyMap(map_t *map) {
+    for (int i = 0; i < map->numLinedefs; ++i) {
+        map->linedefClasses[i] = (unsigned char) getLinedefClass(&map->linedefs[i]);
+    }
+
+    int next[NUM_THING_CLASSES] = { 0 };
+    for (int i = 0; i < map->numThings; ++i) {
+        next[getThingClass(&map->things[i])]++;
+    }
+    map->thingClassStart[0] = 0;
+    for (int c = 0; c < NUM_THING_CLASSES; ++c) {
+        map->thingClassStart[c + 1] = map->thingClassStart[c] + next[c];
+        next[c] = map->thingClassStart[c];
+    }
+    for (int i = 0; i < map->numThings; ++i) {
+        map->thingsByClass[next[getThingClass(&map->things[i])]++] = i;
+    }
+}
+
+//
+// Move the map into a bigger arena with its simplified levels after the rest of its arrays,
+// they're only sized once they've been built from the map
+//
+static map_t *appendMapLod(map_t *map, const maplod_t *lod) {
+    size_t arenaSize = map->arenaSize;
+    for (int i = 0; i < MAP_LOD_LEVELS; ++i) {
+        arenaSize += ALIGN_MAP_ARENA(lod->numLines[i] * sizeof(mapline_t));
+        arenaSize += ALIGN_MAP_ARENA(lod->numLines[i] * sizeof(mapbbox_t));
+    }
+
+    unsigned char *arena = (unsigned char *) allocAligned(MAP_ARENA_ALIGNMENT, arenaSize);
+    memcpy(arena, map, map->arenaSize);
+    map_t *moved = (map_t *) arena;
+    relocateMap(moved, (uintptr_t) map, (uintptr_t) arena);
+
+    size_t offset = map->arenaSize;
+    for (int i = 0; i < MAP_LOD_LEVELS; ++i) {
+        const size_t linesSize = lod->numLines[i] * sizeof(mapline_t);
+        const size_t boundsSize = lod->numLines[i] * sizeof(mapbbox_t);
+        moved->numLodLines[i] = lod->numLines[i];
+        if (lod->numLines[i] == 0) continue;
+
+        moved->lodLines[i] = (mapline_t *) (arena + offset);
+        memcpy(moved->lodLines[i], lod->lines[i], linesSize);
+        offset += ALIGN_MAP_ARENA(linesSize);
+        moved->lodBounds[i] = (mapbbox_t *) (arena + offset);
+        memcpy(moved->lodBounds[i], lod->bounds[i], boundsSize);
+        offset += ALIGN_MAP_ARENA(boundsSize);
+    }
+    assert(offset == arenaSize);
+    moved->arenaSize = arenaSize;
+
+    freeAligned(map);
+    return moved;
+}
+
+//
+// Parse the map's lumps into a new arena.
+// The map_t and all of its arrays share a single aligned allocation.
+//
+static map_t *parseWadMap(const wad_t *wad, const wadmap_t *wadmap) {
+    const uint64_t startTime = getMicroseconds();
+
+    LOG_INFO("Loading map %s from %s...", wadmap->name, wad->fileName);
+
+    // Total up the lump sizes from the directory to size the arena
+    lumpview_t views[NUM_MAP_LUMPS];
+    int counts[NUM_MAP_LUMPS];
+    size_t arenaSize = ALIGN_MAP_ARENA(sizeof(map_t));
+    for (int type = LUMP_THINGS; type < NUM_MAP_LUMPS; ++type) {
+        if (getMapLumpView(wad, wadmap, (MapLevelType) type, &views[type], &counts[type])) {
+            arenaSize += ALIGN_MAP_ARENA(counts[type] * mapLumpRecordSizes[type]);
         }
+    }
+    const size_t vertexArraySize = ALIGN_MAP_ARENA(counts[LUMP_VERTEXES] * sizeof(float));
+    const size_t thingArraySize = ALIGN_MAP_ARENA(counts[LUMP_THINGS] * sizeof(float));
+    const size_t linedefBoundsSize = ALIGN_MAP_ARENA(counts[LUMP_LINEDEFS] * sizeof(mapbbox_t));
+    const size_t linedefClassesSize = ALIGN_MAP_ARENA(counts[LUMP_LINEDEFS] * sizeof(unsigned char));
+    const size_t thingsByClassSize = ALIGN_MAP_ARENA(counts[LUMP_THINGS] * sizeof(int));
+    arenaSize += 2 * vertexArraySize + 2 * thingArraySize + linedefBoundsSize + linedefClassesSize + thingsByClassSize;
 
-        printf("\n%s - %.*s, %d lumps, dictionary @ %x (%d bytes)\n",
-               wadFileName, 4, wadinfo.identification, wadinfo.numLumps,
-               wadinfo.infoTableOffset, wadinfo.infoTableOffset);
-
-        fseek(wadFile, wadinfo.infoTableOffset, SEEK_SET);
-        fpos_t fpos;
-        fgetpos(wadFile, &fpos);
-
-        // Read in map lumps
-        filelump_t lump;
-        for (int i = 0; i < wadinfo.numLumps; ++i) {
-            fread(&lump, sizeof(filelump_t), 1, wadFile);
-            if (strncmp(lump.name, map->label.name, 8) == 0) {
-                printf("Found map label lump: %.*s (expected %.*s)\n",
-                       8, lump.name, 8, map->label.name);
-                break;
-            }
+    unsigned char *arena = (unsigned char *) allocAligned(MAP_ARENA_ALIGNMENT, arenaSize);
+    map_t *map = (map_t *) arena;
+    memset(map, 0, sizeof(map_t));
+    map->arenaSize = arenaSize;
+    map->label = wad->directory[wadmap->lumps[LUMP_LABEL]];
+
+    // Carve each lump's records out of the arena in one bulk copy
+    void *lumps[NUM_MAP_LUMPS] = { NULL };
+    size_t offset = ALIGN_MAP_ARENA(sizeof(map_t));
+    for (int type = LUMP_THINGS; type < NUM_MAP_LUMPS; ++type) {
+        if (counts[type] == 0) continue;
+
+        const uint64_t lumpStartTime = getMicroseconds();
+        const size_t size = counts[type] * mapLumpRecordSizes[type];
+        lumps[type] = arena + offset;
+        memcpy(lumps[type], views[type].data, size);
+        offset += ALIGN_MAP_ARENA(size);
+
+        LOG_INFO("  %-8s %6d records, %7lu bytes, %5lu us", getMapLumpName((MapLevelType) type), counts[type],
+                 (unsigned long) size, (unsigned long) (getMicroseconds() - lumpStartTime));
+    }
+
+    // Followed by the derived arrays
+    void *derived[7] = { NULL };
+    const size_t derivedSizes[7] = { vertexArraySize, vertexArraySize, thingArraySize, thingArraySize, linedefBoundsSize,
+                                     linedefClassesSize, thingsByClassSize };
+    for (int i = 0; i < 7; ++i) {
+        if (derivedSizes[i] == 0) continue;
+        derived[i] = arena + offset;
+        offset += derivedSizes[i];
+    }
+    assert(offset == arenaSize);
+
+    map->things     = (mapthing_t *)     lumps[LUMP_THINGS];   map->numThings     = counts[LUMP_THINGS];
+    map->linedefs   = (linedef_t *)      lumps[LUMP_LINEDEFS]; map->numLinedefs   = counts[LUMP_LINEDEFS];
+    map->sidedefs   = (sidedef_t *)      lumps[LUMP_SIDEDEFS]; map->numSidedefs   = counts[LUMP_SIDEDEFS];
+    map->vertices   = (mapvertex_t *)    lumps[LUMP_VERTEXES]; map->numVertexes   = counts[LUMP_VERTEXES];
+    map->segs       = (mapseg_t *)       lumps[LUMP_SEGS];     map->numSegs       = counts[LUMP_SEGS];
+    map->subsectors = (mapsubsector_t *) lumps[LUMP_SSECTORS]; map->numSubsectors = counts[LUMP_SSECTORS];
+    map->nodes      = (mapnode_t *)      lumps[LUMP_NODES];    map->numNodes      = counts[LUMP_NODES];
+    map->sectors    = (mapsector_t *)    lumps[LUMP_SECTORS];  map->numSectors    = counts[LUMP_SECTORS];
+    map->reject     = (unsigned char *)  lumps[LUMP_REJECT];   map->rejectSize    = counts[LUMP_REJECT];
+    map->blockmap   = (short *)          lumps[LUMP_BLOCKMAP]; map->blockmapSize  = counts[LUMP_BLOCKMAP];
+    map->vertexX       = (float *)     derived[0];
+    map->vertexY       = (float *)     derived[1];
+    map->thingX        = (float *)     derived[2];
+    map->thingY        = (float *)     derived[3];
+    map->linedefBounds = (mapbbox_t *) derived[4];
+    map->linedefClasses = (unsigned char *) derived[5];
+    map->thingsByClass = (int *) derived[6];
+
+    const uint64_t decodeStartTime = getMicroseconds();
+    validateLinedefs(map, wadmap->name);
+    validateMapBsp(map, wadmap->name);
+    decodeMapPositions(map);
+    computeLinedefBounds(map);
+    classifyMap(map);
+    LOG_INFO("  Decoded %d vertex and %d thing positions and %d linedef bounds in %lu us",
+             map->numVertexes, map->numThings, map->numLinedefs, (unsigned long) (getMicroseconds() - decodeStartTime));
+
+    maplod_t lod;
+    buildMapLod(map, &lod);
+    map = appendMapLod(map, &lod);
+    freeMapLod(&lod);
+
+    // REJECT is a bit matrix of sector pairs, Doom tolerates it being short but reads past it if so
+    const int expectedRejectSize = (map->numSectors * map->numSectors + 7) / 8;
+    if (map->rejectSize < expectedRejectSize) {
+        LOG_WARN("REJECT in map %s is %d bytes, expected %d for %d sectors",
+                 wadmap->name, map->rejectSize, expectedRejectSize, map->numSectors);
+    }
+
+    LOG_INFO("Loaded map %s, %lu bytes in %lu us", wadmap->name,
+             (unsigned long) map->arenaSize, (unsigned long) (getMicroseconds() - startTime));
+    return map;
+}
+
+//
+// Move every array pointer in the map from one arena base address to another,
+// a base of 0 turns pointers into arena offsets and back
+//
+void relocateMap(map_t *map, uintptr_t fromBase, uintptr_t toBase) {
+    assert(map != NULL);
+
+    for (size_t i = 0; i < NUM_MAP_ARRAYS; ++i) {
+        uintptr_t *pointer = (uintptr_t *) ((unsigned char *) map + mapArrays[i].pointerOffset);
+        if (*pointer != 0) {
+            *pointer = *pointer - fromBase + toBase;
         }
+    }
+}
 
-        // ---- Things
-        fread(&lump, sizeof(filelump_t), 1, wadFile);
-        if (strncmp(lump.name, "THINGS", 8) != 0) {
-            printf("Unexpected lump: '%8.*s' (expected 'THINGS'), %5d bytes, offset @ 0x%x (%d bytes)\n",
-                   8, lump.name, lump.size, lump.filePos, lump.filePos);
-        } else {
-            fgetpos(wadFile, &fpos);
-            fseek(wadFile, lump.filePos, SEEK_SET);
-            {
-                map->numThings = lump.size / sizeof(mapthing_t);
-                map->things = (mapthing_t *) calloc((size_t) map->numThings, sizeof(mapthing_t));
-                printf("Reading %d things... ", map->numThings);
-                for (int i = 0; i < map->numThings; ++i) {
-                    fread(&map->things[i], sizeof(mapthing_t), 1, wadFile);
-                    printf("{pos: (%d, %d), angle: %d, type: 0x%04x, options: 0x%04x} ",
-                           map->things[i].x, map->things[i].y, map->things[i].angle,
-                           map->things[i].type, map->things[i].options);
-                }
-                printf("\n");
-            }
-            fsetpos(wadFile, &fpos);
+//
+// Check that every array of a map in arena offset form lies within its arena
+//
+bool validateMapOffsets(const map_t *map) {
+    assert(map != NULL);
+
+    for (size_t i = 0; i < NUM_MAP_ARRAYS; ++i) {
+        const uintptr_t offset = *(const uintptr_t *) ((const unsigned char *) map + mapArrays[i].pointerOffset);
+        const int count = *(const int *) ((const unsigned char *) map + mapArrays[i].countOffset);
+        if (count < 0 || (offset == 0 && count != 0)) {
+            return false;
+        }
+        if (offset != 0 && (offset < sizeof(map_t) || offset > map->arenaSize
+         || (size_t) count > (map->arenaSize - offset) / mapArrays[i].recordSize
+         || offset % MAP_ARENA_ALIGNMENT != 0)) {
+            return false;
         }
+    }
+    return true;
+}
 
-        // ---- LineDefs
-        fread(&lump, sizeof(filelump_t), 1, wadFile);
-        if (strncmp(lump.name, "LINEDEFS", 8) != 0) {
-            printf("Unexpected lump: '%8.*s' (expected 'LINEDEFS'), %5d bytes, offset @ 0x%x (%d bytes)\n",
-                   8, lump.name, lump.size, lump.filePos, lump.filePos);
-        } else {
-            fgetpos(wadFile, &fpos);
-            fseek(wadFile, lump.filePos, SEEK_SET);
-            {
-                map->numLinedefs = lump.size / sizeof(linedef_t);
-                map->linedefs = (linedef_t *) calloc((size_t) map->numLinedefs, sizeof(linedef_t));
-                printf("Reading %d linedefs... ", map->numLinedefs);
-                for (int i = 0; i < map->numLinedefs; ++i) {
-                    fread(&map->linedefs[i], sizeof(linedef_t), 1, wadFile);
-                    printf("{v1,2: (%d, %d), flags: 0x%08x, special: 0x%08x, tag: %3d, sideNum 0x%2x%2x} ",
-                           map->linedefs[i].v1, map->linedefs[i].v2, map->linedefs[i].flags,
-                           map->linedefs[i].special, map->linedefs[i].tag, map->linedefs[i].sideNum[0],
-                           map->linedefs[i].sideNum[1]);
-                }
-                printf("\n");
-            }
-            fsetpos(wadFile, &fpos);
+//
+// Check every index in a map from a map cache file, so a corrupt one can't reach outside of its arrays.
+// Loading leaves them all in range, see validateLinedefs() and validateMapBsp().
+//
+bool validateMapIndices(const map_t *map) {
+    assert(map != NULL);
+
+    for (int i = 0; i < map->numLinedefs; ++i) {
+        const linedef_t *line = &map->linedefs[i];
+        if ((unsigned short) line->v1 >= map->numVertexes || (unsigned short) line->v2 >= map->numVertexes
+         || map->linedefClasses[i] >= NUM_LINEDEF_CLASSES) {
+            return false;
+        }
+        for (int side = 0; side < 2; ++side) {
+            if (line->sideNum[side] != -1 && (unsigned short) line->sideNum[side] >= map->numSidedefs) return false;
         }
+    }
+    if (findMapBspProblem(map) != NULL) {
+        return false;
+    }
 
-        // ---- SideDefs
-        fread(&lump, sizeof(filelump_t), 1, wadFile);
-        if (strncmp(lump.name, "SIDEDEFS", 8) != 0) {
-            printf("Unexpected lump: '%8.*s' (expected 'SIDEDEFS'), %5d bytes, offset @ 0x%x (%d bytes)\n",
-                   8, lump.name, lump.size, lump.filePos, lump.filePos);
-        } else {
-            fgetpos(wadFile, &fpos);
-            fseek(wadFile, lump.filePos, SEEK_SET);
-            {
-                map->numSidedefs = lump.size / sizeof(sidedef_t);
-                map->sidedefs = (sidedef_t *) calloc((size_t) map->numSidedefs, sizeof(sidedef_t));
-                printf("Reading %d sidedefs... ", map->numSidedefs);
-                for (int i = 0; i < map->numLinedefs; ++i) {
-                    fread(&map->sidedefs[i], sizeof(sidedef_t), 1, wadFile);
-                    printf("{texoff: %d, rowoff: %d, toptex: %.*s, bottex: %.*s, midtex: %.*s, sector: %d} ",
-                           map->sidedefs[i].textureOffset, map->sidedefs[i].rowOffset,
-                           8, map->sidedefs[i].topTexture, 8, map->sidedefs[i].bottomTexture, 8,
-                           map->sidedefs[i].midTexture,
-                           map->sidedefs[i].sector);
-                }
-                printf("\n");
+    if (map->thingClassStart[0] != 0 || map->thingClassStart[NUM_THING_CLASSES] != map->numThings) {
+        return false;
+    }
+    for (int c = 0; c < NUM_THING_CLASSES; ++c) {
+        if (map->thingClassStart[c + 1] < map->thingClassStart[c]) return false;
+    }
+    for (int i = 0; i < map->numThings; ++i) {
+        if (map->thingsByClass[i] < 0 || map->thingsByClass[i] >= map->numThings) return false;
+    }
+
+    for (int level = 0; level < MAP_LOD_LEVELS; ++level) {
+        for (int i = 0; i < map->numLodLines[level]; ++i) {
+            const mapline_t line = map->lodLines[level][i];
+            if (line.v1 < 0 || line.v1 >= map->numVertexes || line.v2 < 0 || line.v2 >= map->numVertexes
+             || line.linedef < 0 || line.linedef >= map->numLinedefs) {
+                return false;
             }
-            fsetpos(wadFile, &fpos);
         }
+    }
+    return true;
+}
+
+//
+// Load the map specified by its directory index entry, from its map cache file when
+// that's up to date, otherwise from the WAD, writing a fresh cache file for next time.
+// Release it with freeMap().
+//
+map_t *loadWadMap(const wad_t *wad, const wadmap_t *wadmap) {
+    assert(wad != NULL && wadmap != NULL);
+    const uint64_t startTime = getMicroseconds();
+
+    char cachePath[1024];
+    getMapCacheFilePath(wad, wadmap, cachePath, sizeof(cachePath));
+    const uint64_t checksum = getMapSourceChecksum(wad, wadmap);
+
+    map_t *map = loadMapCacheFile(cachePath, checksum);
+    if (map != NULL) {
+        LOG_INFO("Loaded map %s from '%s', %lu bytes in %lu us", wadmap->name, cachePath,
+                 (unsigned long) map->arenaSize, (unsigned long) (getMicroseconds() - startTime));
+        return map;
+    }
+
+    map = parseWadMap(wad, wadmap);
+    saveMapCacheFile(cachePath, map, checksum);
+    return map;
+}
+
+//
+// Walk the map's BSP for the subsectors whose node bounding boxes touch the box, returns how many there are.
+// The stack needs room for numNodes entries, and subsectors for numSubsectors.
+//
+int findMapSubsectors(const map_t *map, const int box[4], int *stack, int *subsectors) {
+    assert(map != NULL && box != NULL && stack != NULL && subsectors != NULL);
+
+    if (map->numNodes == 0) {
+        // A map of one subsector doesn't need a node
+        if (map->numSubsectors == 1) subsectors[0] = 0;
+        return map->numSubsectors == 1 ? 1 : 0;
+    }
 
-        // ---- Vertexes
-        fread(&lump, sizeof(filelump_t), 1, wadFile);
-        if (strncmp(lump.name, "VERTEXES", 8) != 0) {
-            printf("Unexpected lump: '%8.*s' (expected 'VERTEXES'), %5d bytes, offset @ 0x%x (%d bytes)\n",
-                   8, lump.name, lump.size, lump.filePos, lump.filePos);
-        } else {
-            fgetpos(wadFile, &fpos);
-            fseek(wadFile, lump.filePos, SEEK_SET);
-            {
-                map->numVertexes = lump.size / sizeof(mapvertex_t);
-                map->vertices = (mapvertex_t *) calloc((size_t) map->numVertexes, sizeof(mapvertex_t));
-                printf("Reading %d vertices... ", map->numVertexes);
-                for (int i = 0; i < map->numVertexes; ++i) {
-                    fread(&map->vertices[i], sizeof(mapvertex_t), 1, wadFile);
-                    printf("{pos: (%d,%d)} ", map->vertices[i].x, map->vertices[i].y);
-                }
-                printf("\n");
+    int count = 0;
+    int depth = 0;
+    stack[depth++] = map->numNodes - 1; // the root
+    while (depth > 0) {
+        const mapnode_t *node = &map->nodes[stack[--depth]];
+        for (int side = 0; side < 2; ++side) {
+            const short *bbox = node->bbox[side];
+            if (bbox[BOXRIGHT] < box[BOXLEFT] || bbox[BOXLEFT] > box[BOXRIGHT]
+             || bbox[BOXTOP] < box[BOXBOTTOM] || bbox[BOXBOTTOM] > box[BOXTOP]) {
+                continue;
             }
-            fsetpos(wadFile, &fpos);
-        }
 
-        // TODO: read other map lumps as needed
+            const int child = node->children[side];
+            if (child & NF_SUBSECTOR) {
+                subsectors[count++] = child & ~NF_SUBSECTOR;
+            } else {
+                stack[depth++] = child;
+            }
+        }
     }
+    return count;
+}
+
+//
+// Classify a linedef for drawing, hidden and secret flags take precedence over its special
+//
+LinedefClass getLinedefClass(const linedef_t *line) {
+    assert(line != NULL);
 
-    fclose(wadFile);
+    if (line->flags & ML_DONTDRAW) return LINEDEF_HIDDEN;
+    if (line->flags & ML_SECRET)   return LINEDEF_SECRET;
+    if (line->special != 0)        return LINEDEF_SPECIAL;
+    if ((line->flags & ML_TWOSIDED) || line->sideNum[1] != -1) return LINEDEF_TWO_SIDED;
+    return LINEDEF_ONE_SIDED;
 }
 
+//
+// Classify a thing by its Doom and Doom II type number
+//
+ThingClass getThingClass(const mapthing_t *thing) {
+    assert(thing != NULL);
+
+    switch (thing->type) {
+        case 1: case 2: case 3: case 4: case 11:
+            return THING_PLAYER;
+        case 7: case 9: case 16: case 58: case 64: case 65: case 66: case 67: case 68: case 69:
+        case 71: case 72: case 84: case 88: case 89:
+        case 3001: case 3002: case 3003: case 3004: case 3005: case 3006:
+            return THING_MONSTER;
+        case 82: case 2001: case 2002: case 2003: case 2004: case 2005: case 2006:
+            return THING_WEAPON;
+        case 8: case 17: case 2007: case 2008: case 2010: case 2046: case 2047: case 2048: case 2049:
+            return THING_AMMO;
+        case 83: case 2011: case 2012: case 2013: case 2014: case 2015: case 2018: case 2019:
+        case 2022: case 2023: case 2024: case 2025: case 2026: case 2045:
+            return THING_PICKUP;
+        case 5: case 6: case 13: case 38: case 39: case 40:
+            return THING_KEY;
+        default:
+            return THING_OTHER;
+    }
+}
+
+//
+// Release a map and all of its arrays
+//
 void freeMap(map_t *map) {
     if (map == NULL) return;
-    free(map->vertices); map->numVertexes = 0;
-    free(map->sidedefs); map->numSidedefs = 0;
-    free(map->linedefs); map->numLinedefs = 0;
-    free(map->things);   map->numThings   = 0;
-    free(map);
+    if (map->backingFile != NULL) {
+        // The map lives inside the mapping
+        unmapFile(map->backingFile);
+    } else {
+        freeAligned(map);
+    }
 }
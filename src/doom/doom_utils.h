@@ -3,40 +3,13 @@
 
 #include <stdint.h>
 
+#include "wad.h"
+
 /*
  * https://zdoom.org/wiki/WAD
  * https://github.com/id-Software/DOOM
  */
 
-// WAD file header
-typedef struct {
-    char identification[4]; // "IWAD" or "PWAD"
-    int numLumps;
-    int infoTableOffset;
-} wadinfo_t;
-
-// WAD file lump info table entry
-typedef struct {
-    int filePos;
-    int size;
-    char name[8];
-} filelump_t;
-
-// Map level types, defined in the order of Lumps in a map WAD
-enum {
-    LUMP_LABEL,    // a separator, name, ExMx or MAPxx
-    LUMP_THINGS,   // monsters, items, etc...
-    LUMP_LINEDEFS, // linedefs, from editing
-    LUMP_SIDEDEFS, // sidedefs, from editin
-    LUMP_VERTEXES, // vertices, edited and BSP splits generated
-    LUMP_SEGS,     // linesegs, from linedefs split by bsp
-    LUMP_SSECTORS, // subsectors, list of linesegs
-    LUMP_NODES,    // BSP nodes
-    LUMP_SECTORS,  // sectors, from editing
-    LUMP_REJECT,   // LUT, sector-sector visibility
-    LUMP_BLOCKMAP  // LUT, motion clippingg, walls/grid element
-} MapLevelType;
-
 // A single vertex
 typedef struct {
     short x;
@@ -94,6 +67,16 @@ typedef struct {
 // Set if already seen, thus drawn in automap.
 #define ML_MAPPED		256
 
+// Automap style classes of linedef, in drawing order
+typedef enum {
+    LINEDEF_TWO_SIDED,
+    LINEDEF_ONE_SIDED,
+    LINEDEF_SPECIAL, // triggers an action, eg. doors, lifts and teleporters
+    LINEDEF_SECRET,  // ML_SECRET, drawn as one sided in Doom's automap
+    LINEDEF_HIDDEN,  // ML_DONTDRAW
+    NUM_LINEDEF_CLASSES
+} LinedefClass;
+
 // Sector definition, from editing
 typedef struct {
     short floorHeight;
@@ -149,33 +132,95 @@ typedef struct {
     short options;
 } mapthing_t;
 
+// Broad categories of thing type, for drawing
+typedef enum {
+    THING_OTHER,   // decorations, and types we don't know
+    THING_PLAYER,  // player and deathmatch starts
+    THING_MONSTER,
+    THING_WEAPON,
+    THING_AMMO,
+    THING_PICKUP,  // health, armor and powerups
+    THING_KEY,
+    NUM_THING_CLASSES
+} ThingClass;
+
+// Bounding box, indexed like a node's bbox
+enum { BOXTOP, BOXBOTTOM, BOXLEFT, BOXRIGHT };
+typedef struct {
+    short box[4];
+} mapbbox_t;
+
+// A line between two map vertices, drawn in the class of its linedef
+typedef struct {
+    int v1;
+    int v2;
+    int linedef;
+} mapline_t;
+
+// Levels of simplified linedefs kept with a map for zoomed out views, see map_lod.h
+#define MAP_LOD_LEVELS 3
+
 //
 // Loading helpers
 //
+
+// A view of the maps in a WAD's directory index
 typedef struct {
     int count;
-    int capacity;
-    filelump_t *lumps;
+    const wadmap_t *maps;
 } maplumps_t;
 
+// A loaded map, the struct and all of its arrays live in one arena,
+// either an allocation or a mapped map cache file
 typedef struct {
+    size_t arenaSize;
+    MappedFile *backingFile; // NULL unless mapped from a map cache file
     int numThings;
     int numLinedefs;
     int numSidedefs;
     int numVertexes;
+    int numSegs;
+    int numSubsectors;
+    int numNodes;
+    int numSectors;
+    int rejectSize;   // in bytes
+    int blockmapSize; // in shorts
     filelump_t label;
+    mapbbox_t bounds; // of all vertices, empty (top < bottom) if there are none
     mapthing_t *things;
     linedef_t *linedefs;
     sidedef_t *sidedefs;
     mapvertex_t *vertices;
+    mapseg_t *segs;
+    mapsubsector_t *subsectors;
+    mapnode_t *nodes;
+    mapsector_t *sectors;
+    unsigned char *reject;
+    short *blockmap;
+    // Derived at load time, structure-of-arrays copies of the vertex and thing positions
+    float *vertexX;
+    float *vertexY;
+    float *thingX;
+    float *thingY;
+    mapbbox_t *linedefBounds;
+    unsigned char *linedefClasses; // LinedefClass of each linedef
+    // Things sorted by class, thingsByClass[thingClassStart[c]] up to thingsByClass[thingClassStart[c + 1]]
+    int thingClassStart[NUM_THING_CLASSES + 1];
+    int *thingsByClass;
+    // The simplified levels, with the bounds of each of their lines
+    int numLodLines[MAP_LOD_LEVELS];
+    mapline_t *lodLines[MAP_LOD_LEVELS];
+    mapbbox_t *lodBounds[MAP_LOD_LEVELS];
 } map_t;
 
-maplumps_t *initMapLumps(int initialSize);
-void insertMapLump(maplumps_t *maplumps, filelump_t *lump);
-void freeMapLumps(maplumps_t *maplumps);
-
-void readWadMaps(const char *wadFileName, maplumps_t *mapLumps);
-void loadWadMap(const char *wadFileName, filelump_t *mapLabel, map_t *map);
+void readWadMaps(const wad_t *wad, maplumps_t *mapLumps);
+map_t *loadWadMap(const wad_t *wad, const wadmap_t *wadmap);
+void relocateMap(map_t *map, uintptr_t fromBase, uintptr_t toBase);
+bool validateMapOffsets(const map_t *map);
+bool validateMapIndices(const map_t *map);
+int findMapSubsectors(const map_t *map, const int box[4], int *stack, int *subsectors);
+LinedefClass getLinedefClass(const linedef_t *line);
+ThingClass getThingClass(const mapthing_t *thing);
 void freeMap(map_t *map);
 
 #endif //SERAPH_DOOM_UTILS_H
@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "map_cache_file.h"
+#include "../log.h"
+
+typedef char assertHeaderSize[sizeof(mapcacheheader_t) == MAP_CACHE_HEADER_SIZE ? 1 : -1];
+
+void getMapCacheFilePath(const wad_t *wad, const wadmap_t *wadmap, char *path, size_t pathSize) {
+    assert(wad != NULL && wadmap != NULL && path != NULL);
+    snprintf(path, pathSize, "%s.%s.mapcache", wad->fileName, wadmap->name);
+}
+
+//
+// Hash a block of bytes 8 at a time, a multiply-xorshift mix in the spirit of FNV-1a.
+// Blocks of 32 bytes go through four independent lanes so the multiplies pipeline instead of serializing,
+// then the rest a word at a time, the last partial word padded with zeros.
+//
+static uint64_t hashBytes(uint64_t hash, const unsigned char *data, size_t size) {
+    const uint64_t prime = 0x100000001B3ull;
+
+    size_t i = 0;
+    if (size >= 32) {
+        uint64_t lanes[4] = { hash, hash ^ 1, hash ^ 2, hash ^ 3 };
+        for (; i + 32 <= size; i += 32) {
+            uint64_t words[4];
+            memcpy(words, data + i, sizeof(words));
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes[lane] = (lanes[lane] ^ words[lane]) * prime;
+                lanes[lane] ^= lanes[lane] >> 29;
+            }
+        }
+        hash = lanes[0];
+        for (int lane = 1; lane < 4; ++lane) {
+            hash = (hash ^ lanes[lane]) * prime;
+        }
+    }
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, size - i);
+        hash = (hash ^ word ^ ((uint64_t) (size - i) << 56)) * prime;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+//
+// Checksum the map's label and the bytes of all of its lumps,
+// so editing any of them invalidates the cache file
+//
+uint64_t getMapSourceChecksum(const wad_t *wad, const wadmap_t *wadmap) {
+    assert(wad != NULL && wadmap != NULL);
+
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hashBytes(hash, (const unsigned char *) wadmap->name, sizeof(wadmap->name));
+    for (int type = LUMP_THINGS; type < NUM_MAP_LUMPS; ++type) {
+        lumpview_t view;
+        const uint64_t size = getWadLumpView(wad, wadmap->lumps[type], &view) ? view.size : UINT64_MAX;
+        hash = hashBytes(hash, (const unsigned char *) &size, sizeof(size));
+        if (size != UINT64_MAX) {
+            hash = hashBytes(hash, view.data, view.size);
+        }
+    }
+    return hash;
+}
+
+//
+// Map a cache file copy-on-write and use its arena in place, once its arrays and the indices
+// in them check out. Returns NULL if it's missing, stale, corrupt, or from an incompatible build.
+//
+map_t *loadMapCacheFile(const char *path, uint64_t checksum) {
+    assert(path != NULL);
+
+    MappedFile *file = mapFileCopyOnWrite(path);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    mapcacheheader_t header;
+    if (file->size < MAP_CACHE_HEADER_SIZE + sizeof(map_t)) {
+        LOG_WARN("Ignoring map cache '%s', too small", path);
+        unmapFile(file);
+        return NULL;
+    }
+    memcpy(&header, file->data, sizeof(header));
+
+    if (memcmp(header.magic, MAP_CACHE_MAGIC, sizeof(header.magic)) != 0
+     || header.version != MAP_CACHE_VERSION
+     || header.mapSize != sizeof(map_t)
+     || header.pointerSize != sizeof(void *)
+     || header.arenaSize != file->size - MAP_CACHE_HEADER_SIZE) {
+        LOG_DEBUG("Ignoring map cache '%s', written by an incompatible build", path);
+        unmapFile(file);
+        return NULL;
+    }
+    if (header.checksum != checksum) {
+        LOG_DEBUG("Ignoring map cache '%s', its WAD has changed", path);
+        unmapFile(file);
+        return NULL;
+    }
+
+    // Only the page holding the map_t is written to, the arrays stay shared with the page cache
+    unsigned char *arena = (unsigned char *) file->data + MAP_CACHE_HEADER_SIZE;
+    map_t *map = (map_t *) arena;
+    if (map->arenaSize != header.arenaSize || !validateMapOffsets(map)) {
+        LOG_WARN("Ignoring map cache '%s', its arena is corrupt", path);
+        unmapFile(file);
+        return NULL;
+    }
+    relocateMap(map, 0, (uintptr_t) arena);
+    if (!validateMapIndices(map)) {
+        LOG_WARN("Ignoring map cache '%s', it refers outside of its arrays", path);
+        unmapFile(file);
+        return NULL;
+    }
+    map->backingFile = file;
+    return map;
+}
+
+//
+// Write the map's arena to a cache file, through a temporary file
+// so a partially written cache is never picked up
+//
+bool saveMapCacheFile(const char *path, const map_t *map, uint64_t checksum) {
+    assert(path != NULL && map != NULL && map->backingFile == NULL);
+
+    mapcacheheader_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAP_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MAP_CACHE_VERSION;
+    header.mapSize = sizeof(map_t);
+    header.checksum = checksum;
+    header.arenaSize = map->arenaSize;
+    header.pointerSize = sizeof(void *);
+
+    // Swap array pointers for arena offsets in a copy of the map_t
+    map_t image = *map;
+    relocateMap(&image, (uintptr_t) map, 0);
+
+    char tempPath[1024];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    FILE *file = fopen(tempPath, "wb");
+    if (file == NULL) {
+        LOG_WARN("Failed to write map cache '%s'", tempPath);
+        return false;
+    }
+    const size_t arraysSize = map->arenaSize - sizeof(map_t);
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+                && fwrite(&image, sizeof(image), 1, file) == 1
+                && (arraysSize == 0 || fwrite((const unsigned char *) map + sizeof(map_t), arraysSize, 1, file) == 1);
+    written = (fclose(file) == 0) && written;
+
+    // rename() won't replace an existing file everywhere
+    remove(path);
+    if (!written || rename(tempPath, path) != 0) {
+        LOG_WARN("Failed to write map cache '%s'", path);
+        remove(tempPath);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef SERAPH_MAP_CACHE_FILE_H
+#define SERAPH_MAP_CACHE_FILE_H
+
+#include <stdint.h>
+
+#include "doom_utils.h"
+
+/*
+ * A map cache file is a fully loaded map arena saved to disk next to its WAD,
+ * so it can be mapped and used in place instead of being parsed and derived again.
+ *
+ * Layout: mapcacheheader_t, then the arena image starting with its map_t,
+ * whose array pointers are stored as offsets from the start of the arena.
+ */
+
+#define MAP_CACHE_MAGIC "SRPHMAP"
+#define MAP_CACHE_VERSION 4
+#define MAP_CACHE_HEADER_SIZE 64
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t mapSize;     // sizeof(map_t) of the build that wrote it
+    uint64_t checksum;    // of the source lumps in the WAD
+    uint64_t arenaSize;
+    uint32_t pointerSize;
+    uint32_t reserved[7];
+} mapcacheheader_t;
+
+void getMapCacheFilePath(const wad_t *wad, const wadmap_t *wadmap, char *path, size_t pathSize);
+uint64_t getMapSourceChecksum(const wad_t *wad, const wadmap_t *wadmap);
+map_t *loadMapCacheFile(const char *path, uint64_t checksum);
+bool saveMapCacheFile(const char *path, const map_t *map, uint64_t checksum);
+
+#endif //SERAPH_MAP_CACHE_FILE_H
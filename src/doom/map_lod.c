@@ -0,0 +1,293 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "map_lod.h"
+#include "../common.h"
+#include "../log.h"
+
+// Linedefs joined end to end through vertices where only two lines of the same class meet.
+// Chain c's lines start at lines[firstLine[c]], its vertices, one more than its lines, at vertices[firstVertex[c]].
+typedef struct MapChains {
+    int numChains;
+    int *firstLine;
+    int *firstVertex;
+    int *lines;
+    int *vertices;
+} MapChains;
+
+// The drawn linedefs touching each vertex, vertexLines[vertexStart[v]] up to vertexLines[vertexStart[v + 1]]
+typedef struct VertexLines {
+    int *vertexStart;
+    int *vertexLines;
+} VertexLines;
+
+static bool isDrawnLine(const map_t *map, const unsigned char *classes, int i) {
+    return classes[i] != LINEDEF_HIDDEN && map->linedefs[i].v1 != map->linedefs[i].v2;
+}
+
+static int otherVertex(const map_t *map, int line, int vertex) {
+    const int v1 = (unsigned short) map->linedefs[line].v1;
+    return (v1 == vertex) ? (unsigned short) map->linedefs[line].v2 : v1;
+}
+
+//
+// The line continuing a chain through a vertex, or -1 if the chain ends there
+//
+static int nextChainLine(const VertexLines *adjacency, const unsigned char *classes, int vertex, int line) {
+    const int first = adjacency->vertexStart[vertex];
+    if (adjacency->vertexStart[vertex + 1] - first != 2) return -1;
+
+    const int next = (adjacency->vertexLines[first] == line) ? adjacency->vertexLines[first + 1]
+                                                             : adjacency->vertexLines[first];
+    return (classes[next] == classes[line]) ? next : -1;
+}
+
+//
+// Follow a chain from a vertex along a line until it ends, or comes back round to its first line
+//
+static void walkChain(MapChains *chains, const map_t *map, const VertexLines *adjacency, const unsigned char *classes,
+                      bool *visited, int vertex, int line, int *numLines, int *numVertices) {
+    const int c = chains->numChains++;
+    chains->firstLine[c] = *numLines;
+    chains->firstVertex[c] = *numVertices;
+
+    chains->vertices[(*numVertices)++] = vertex;
+    while (line >= 0 && !visited[line]) {
+        visited[line] = true;
+        chains->lines[(*numLines)++] = line;
+        vertex = otherVertex(map, line, vertex);
+        chains->vertices[(*numVertices)++] = vertex;
+        line = nextChainLine(adjacency, classes, vertex, line);
+    }
+
+    chains->firstLine[c + 1] = *numLines;
+    chains->firstVertex[c + 1] = *numVertices;
+}
+
+static MapChains buildMapChains(const map_t *map, const unsigned char *classes) {
+    const int numLinedefs = map->numLinedefs;
+
+    VertexLines adjacency;
+    adjacency.vertexStart = (int *) calloc(map->numVertexes + 1, sizeof(int));
+    adjacency.vertexLines = (int *) calloc(2 * (size_t) MAX(numLinedefs, 1), sizeof(int));
+    for (int i = 0; i < numLinedefs; ++i) {
+        if (!isDrawnLine(map, classes, i)) continue;
+        adjacency.vertexStart[(unsigned short) map->linedefs[i].v1 + 1]++;
+        adjacency.vertexStart[(unsigned short) map->linedefs[i].v2 + 1]++;
+    }
+    for (int v = 0; v < map->numVertexes; ++v) {
+        adjacency.vertexStart[v + 1] += adjacency.vertexStart[v];
+    }
+    int *next = (int *) calloc(MAX(map->numVertexes, 1), sizeof(int));
+    for (int v = 0; v < map->numVertexes; ++v) {
+        next[v] = adjacency.vertexStart[v];
+    }
+    for (int i = 0; i < numLinedefs; ++i) {
+        if (!isDrawnLine(map, classes, i)) continue;
+        adjacency.vertexLines[next[(unsigned short) map->linedefs[i].v1]++] = i;
+        adjacency.vertexLines[next[(unsigned short) map->linedefs[i].v2]++] = i;
+    }
+    free(next);
+
+    // Every line is in one chain, and every chain has a line
+    MapChains chains = { 0 };
+    chains.firstLine   = (int *) calloc(numLinedefs + 1, sizeof(int));
+    chains.firstVertex = (int *) calloc(numLinedefs + 1, sizeof(int));
+    chains.lines       = (int *) calloc(MAX(numLinedefs, 1), sizeof(int));
+    chains.vertices    = (int *) calloc(2 * (size_t) MAX(numLinedefs, 1), sizeof(int));
+    bool *visited = (bool *) calloc(MAX(numLinedefs, 1), sizeof(bool));
+    int numLines = 0;
+    int numVertices = 0;
+
+    // Open chains first, starting from either end
+    for (int i = 0; i < numLinedefs; ++i) {
+        if (visited[i] || !isDrawnLine(map, classes, i)) continue;
+        const int v1 = (unsigned short) map->linedefs[i].v1;
+        const int v2 = (unsigned short) map->linedefs[i].v2;
+        if (nextChainLine(&adjacency, classes, v1, i) < 0) {
+            walkChain(&chains, map, &adjacency, classes, visited, v1, i, &numLines, &numVertices);
+        } else if (nextChainLine(&adjacency, classes, v2, i) < 0) {
+            walkChain(&chains, map, &adjacency, classes, visited, v2, i, &numLines, &numVertices);
+        }
+    }
+    // Then the closed loops left over, starting anywhere
+    for (int i = 0; i < numLinedefs; ++i) {
+        if (visited[i] || !isDrawnLine(map, classes, i)) continue;
+        walkChain(&chains, map, &adjacency, classes, visited, (unsigned short) map->linedefs[i].v1, i,
+                  &numLines, &numVertices);
+    }
+
+    free(visited);
+    free(adjacency.vertexStart);
+    free(adjacency.vertexLines);
+    return chains;
+}
+
+static void freeMapChains(MapChains *chains) {
+    free(chains->firstLine);
+    free(chains->firstVertex);
+    free(chains->lines);
+    free(chains->vertices);
+}
+
+// Squared distance from a point to the segment from a to b
+static float segmentDistanceSquared(float px, float py, float ax, float ay, float bx, float by) {
+    const float dx = bx - ax;
+    const float dy = by - ay;
+    const float lengthSquared = dx * dx + dy * dy;
+    float t = 0.f;
+    if (lengthSquared > 0.f) {
+        t = ((px - ax) * dx + (py - ay) * dy) / lengthSquared;
+        t = MAX(0.f, MIN(t, 1.f));
+    }
+    const float ex = ax + t * dx - px;
+    const float ey = ay + t * dy - py;
+    return ex * ex + ey * ey;
+}
+
+//
+// Douglas-Peucker simplification of a chain's vertices, keeping the ends
+// and the fewest vertices between that stay within the tolerance in map units
+//
+static void simplifyChain(const map_t *map, const int *vertices, int count, float tolerance, bool *keep, int *stack) {
+    const float *x = map->vertexX;
+    const float *y = map->vertexY;
+    const float toleranceSquared = tolerance * tolerance;
+
+    for (int i = 0; i < count; ++i) {
+        keep[i] = false;
+    }
+    keep[0] = keep[count - 1] = true;
+
+    int top = 0;
+    stack[top++] = 0;
+    stack[top++] = count - 1;
+    while (top > 0) {
+        const int last = stack[--top];
+        const int first = stack[--top];
+        const int a = vertices[first];
+        const int b = vertices[last];
+
+        int farthest = -1;
+        float farthestDistance = toleranceSquared;
+        for (int i = first + 1; i < last; ++i) {
+            const int v = vertices[i];
+            const float distance = segmentDistanceSquared(x[v], y[v], x[a], y[a], x[b], y[b]);
+            if (distance > farthestDistance) {
+                farthest = i;
+                farthestDistance = distance;
+            }
+        }
+        if (farthest < 0) continue;
+
+        keep[farthest] = true;
+        stack[top++] = first;
+        stack[top++] = farthest;
+        stack[top++] = farthest;
+        stack[top++] = last;
+    }
+}
+
+static void buildMapLodLevel(maplod_t *lod, int level, const map_t *map, const MapChains *chains,
+                             bool *keep, int *stack) {
+    const unsigned char *classes = map->linedefClasses;
+    const int scale = getMapLodScale(level);
+    const bool outline = (level == MAP_LOD_LEVELS - 1);
+    mapline_t *lines = (mapline_t *) calloc(MAX(chains->firstLine[chains->numChains], 1), sizeof(mapline_t));
+    int numLines = 0;
+
+    for (int c = 0; c < chains->numChains; ++c) {
+        const int *chainLines = &chains->lines[chains->firstLine[c]];
+        const int *vertices = &chains->vertices[chains->firstVertex[c]];
+        const int count = chains->firstVertex[c + 1] - chains->firstVertex[c];
+        if (outline && classes[chainLines[0]] == LINEDEF_TWO_SIDED) continue;
+
+        // Drop chains that would fit inside a pixel
+        float minX = map->vertexX[vertices[0]], maxX = minX;
+        float minY = map->vertexY[vertices[0]], maxY = minY;
+        for (int i = 1; i < count; ++i) {
+            minX = MIN(minX, map->vertexX[vertices[i]]); maxX = MAX(maxX, map->vertexX[vertices[i]]);
+            minY = MIN(minY, map->vertexY[vertices[i]]); maxY = MAX(maxY, map->vertexY[vertices[i]]);
+        }
+        if (maxX - minX < (float) scale && maxY - minY < (float) scale) continue;
+
+        simplifyChain(map, vertices, count, MAP_LOD_TOLERANCE * (float) scale, keep, stack);
+        int first = 0;
+        for (int i = 1; i < count; ++i) {
+            if (!keep[i]) continue;
+            lines[numLines++] = (mapline_t) { vertices[first], vertices[i], chainLines[first] };
+            first = i;
+        }
+    }
+
+    mapbbox_t *bounds = (mapbbox_t *) calloc(MAX(numLines, 1), sizeof(mapbbox_t));
+    for (int i = 0; i < numLines; ++i) {
+        const mapvertex_t v1 = map->vertices[lines[i].v1];
+        const mapvertex_t v2 = map->vertices[lines[i].v2];
+        short *box = bounds[i].box;
+        box[BOXTOP]    = MAX(v1.y, v2.y);
+        box[BOXBOTTOM] = MIN(v1.y, v2.y);
+        box[BOXLEFT]   = MIN(v1.x, v2.x);
+        box[BOXRIGHT]  = MAX(v1.x, v2.x);
+    }
+    lod->numLines[level] = numLines;
+    lod->lines[level] = lines;
+    lod->bounds[level] = bounds;
+}
+
+//
+// Build the simplified levels of a map's classified linedefs, release them with freeMapLod()
+//
+void buildMapLod(const map_t *map, maplod_t *lod) {
+    assert(map != NULL && lod != NULL);
+
+    const uint64_t startTime = getMicroseconds();
+    MapChains chains = buildMapChains(map, map->linedefClasses);
+
+    // Scratch space for simplifying, sized for the longest chain
+    int maxVertices = 1;
+    for (int c = 0; c < chains.numChains; ++c) {
+        maxVertices = MAX(maxVertices, chains.firstVertex[c + 1] - chains.firstVertex[c]);
+    }
+    bool *keep = (bool *) calloc(maxVertices, sizeof(bool));
+    int *stack = (int *) calloc(2 * (size_t) maxVertices, sizeof(int));
+
+    for (int i = 0; i < MAP_LOD_LEVELS; ++i) {
+        buildMapLodLevel(lod, i, map, &chains, keep, stack);
+        LOG_DEBUG("  LOD level %d from scale %d, %d lines", i, getMapLodScale(i), lod->numLines[i]);
+    }
+    LOG_INFO("  Built %d LOD levels from %d chains of %d linedefs in %lu us", MAP_LOD_LEVELS, chains.numChains,
+             map->numLinedefs, (unsigned long) (getMicroseconds() - startTime));
+
+    free(keep);
+    free(stack);
+    freeMapChains(&chains);
+}
+
+void freeMapLod(maplod_t *lod) {
+    if (lod == NULL) return;
+    for (int i = 0; i < MAP_LOD_LEVELS; ++i) {
+        free(lod->lines[i]);
+        free(lod->bounds[i]);
+        lod->lines[i] = NULL;
+        lod->bounds[i] = NULL;
+    }
+}
+
+// The map units per pixel a level is built for
+int getMapLodScale(int level) {
+    assert(level >= 0 && level < MAP_LOD_LEVELS);
+    return MAP_LOD_MIN_SCALE << level;
+}
+
+//
+// The most simplified level for a scale in map units per pixel, or -1 to draw the full detail
+//
+int getMapLodLevel(float scale) {
+    int level = -1;
+    while (level + 1 < MAP_LOD_LEVELS && (float) getMapLodScale(level + 1) <= scale * MAP_LOD_SCALE_SLACK) {
+        level++;
+    }
+    return level;
+}
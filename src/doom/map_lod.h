@@ -0,0 +1,31 @@
+#ifndef SERAPH_MAP_LOD_H
+#define SERAPH_MAP_LOD_H
+
+#include "doom_utils.h"
+
+// The first of the MAP_LOD_LEVELS is built for this scale in map units per pixel
+// and each one after for double the last, the last keeps only the outline.
+// The camera zooms out to 16 map units per pixel, so the last level is used from half of that.
+#define MAP_LOD_MIN_SCALE 2
+
+// Levels are picked from a hair under their scale, so a zoom that lands on it after a few steps isn't missed by rounding
+#define MAP_LOD_SCALE_SLACK 1.001f
+
+// How far in pixels a simplified line may stray from the lines it replaces
+#define MAP_LOD_TOLERANCE 0.5f
+
+// The simplified levels of a map's linedefs as they're built, before they're copied into its arena.
+// Built from chains of same class linedefs joined end to end, each simplified to the level's tolerance.
+// Chains smaller than a pixel are dropped.
+typedef struct {
+    int numLines[MAP_LOD_LEVELS];
+    mapline_t *lines[MAP_LOD_LEVELS];
+    mapbbox_t *bounds[MAP_LOD_LEVELS];
+} maplod_t;
+
+void buildMapLod(const map_t *map, maplod_t *lod);
+void freeMapLod(maplod_t *lod);
+int getMapLodScale(int level);
+int getMapLodLevel(float scale);
+
+#endif //SERAPH_MAP_LOD_H
@@ -0,0 +1,231 @@
+#include <assert.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "wad.h"
+#include "../log.h"
+
+static const char *mapLumpNames[NUM_MAP_LUMPS] = {
+        "", "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+        "SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP"
+};
+
+static void buildWadIndex(wad_t *wad);
+
+//
+// Map the specified WAD and validate its header and directory
+//
+wad_t *openWad(const char *fileName) {
+    assert(fileName != NULL);
+
+    MappedFile *file = mapFile(fileName);
+    if (file == NULL) {
+        return NULL;
+    }
+
+    // Validate wadinfo
+    wadinfo_t wadinfo;
+    if (file->size < sizeof(wadinfo_t)) {
+        LOG_ERROR("Invalid WAD '%s': %lu bytes is too small for a header", fileName, (unsigned long) file->size);
+        unmapFile(file);
+        return NULL;
+    }
+    memcpy(&wadinfo, file->data, sizeof(wadinfo_t));
+
+    if (strncmp(wadinfo.identification, "IWAD", 4) != 0
+     && strncmp(wadinfo.identification, "PWAD", 4) != 0) {
+        LOG_ERROR("Invalid WAD info: identification '%.*s'", 4, wadinfo.identification);
+        unmapFile(file);
+        return NULL;
+    }
+
+    // Validate that the whole directory lies within the file
+    if (wadinfo.numLumps < 0 || wadinfo.infoTableOffset < 0
+     || (size_t) wadinfo.infoTableOffset > file->size
+     || (size_t) wadinfo.numLumps > (file->size - wadinfo.infoTableOffset) / sizeof(filelump_t)) {
+        LOG_ERROR("Invalid WAD info: %d lumps, dictionary @ %x exceeds file size (%lu bytes)",
+                  wadinfo.numLumps, wadinfo.infoTableOffset, (unsigned long) file->size);
+        unmapFile(file);
+        return NULL;
+    }
+
+    LOG_INFO("%s - %.*s, %d lumps, dictionary @ %x (%d bytes)",
+             fileName, 4, wadinfo.identification, wadinfo.numLumps,
+             wadinfo.infoTableOffset, wadinfo.infoTableOffset);
+
+    wad_t *wad = (wad_t *) calloc(1, sizeof(wad_t));
+    wad->fileName = fileName;
+    wad->file = file;
+    wad->info = wadinfo;
+    wad->numLumps = wadinfo.numLumps;
+
+    // The directory offset has no alignment guarantee, so take one aligned copy of it up front
+    wad->directory = (filelump_t *) calloc((size_t) wad->numLumps + 1, sizeof(filelump_t));
+    memcpy(wad->directory, file->data + wadinfo.infoTableOffset, wad->numLumps * sizeof(filelump_t));
+
+    buildWadIndex(wad);
+
+    return wad;
+}
+
+void closeWad(wad_t *wad) {
+    if (wad == NULL) return;
+    unmapFile(wad->file);
+    free(wad->directory);
+    free(wad->hashKeys);
+    free(wad->hashLumps);
+    free(wad->maps);
+    free(wad->labelMaps);
+    free(wad);
+}
+
+//
+// Get a bounds checked view of the lump at the specified directory index,
+// returns false if the index or the lump's extents are invalid
+//
+bool getWadLumpView(const wad_t *wad, int index, lumpview_t *view) {
+    assert(wad != NULL && view != NULL);
+
+    if (index < 0 || index >= wad->numLumps) {
+        return false;
+    }
+
+    const filelump_t *lump = &wad->directory[index];
+    if (lump->filePos < 0 || lump->size < 0
+     || (size_t) lump->filePos > wad->file->size
+     || (size_t) lump->size > wad->file->size - lump->filePos) {
+        LOG_WARN("Invalid lump %d: '%.*s', %d bytes @ 0x%x exceeds file size",
+                 index, 8, lump->name, lump->size, lump->filePos);
+        return false;
+    }
+
+    view->lump = lump;
+    view->data = wad->file->data + lump->filePos;
+    view->size = (size_t) lump->size;
+    return true;
+}
+
+//
+// Pack a lump name into a single comparable value, upper cased
+// and zero padded past the terminator like Doom's W_CheckNumForName
+//
+uint64_t getLumpKey(const char *name) {
+    assert(name != NULL);
+
+    unsigned char bytes[8] = {0};
+    for (int i = 0; i < 8 && name[i] != '\0'; ++i) {
+        bytes[i] = (unsigned char) toupper((unsigned char) name[i]);
+    }
+
+    uint64_t key;
+    memcpy(&key, bytes, sizeof(key));
+    return key;
+}
+
+static unsigned int hashLumpKey(const wad_t *wad, uint64_t key) {
+    // Fibonacci hashing, the high bits of the product are the best mixed
+    return (unsigned int) ((key * 0x9E3779B97F4A7C15ull) >> wad->hashShift);
+}
+
+//
+// Get the directory index of the named lump, or -1 if it's not in the WAD.
+// Like Doom, later lumps with the same name take precedence.
+//
+int findWadLump(const wad_t *wad, const char *name) {
+    assert(wad != NULL && name != NULL);
+
+    const uint64_t key = getLumpKey(name);
+    for (unsigned int slot = hashLumpKey(wad, key); wad->hashLumps[slot] != -1; slot = (slot + 1) & wad->hashMask) {
+        if (wad->hashKeys[slot] == key) {
+            return wad->hashLumps[slot];
+        }
+    }
+    return -1;
+}
+
+//
+// Get the lump group of the named map, or NULL if it's not in the WAD
+//
+const wadmap_t *findWadMap(const wad_t *wad, const char *name) {
+    assert(wad != NULL && name != NULL);
+
+    int labelIndex = findWadLump(wad, name);
+    if (labelIndex == -1 || wad->labelMaps[labelIndex] == -1) {
+        return NULL;
+    }
+    return &wad->maps[wad->labelMaps[labelIndex]];
+}
+
+const char *getMapLumpName(MapLevelType type) {
+    assert(type >= 0 && type < NUM_MAP_LUMPS);
+    return mapLumpNames[type];
+}
+
+//
+// Build the lump name hash, the per-map lump groups and the label to map table in one pass over the directory
+//
+static void buildWadIndex(wad_t *wad) {
+    // Size the table to a power of two at most half full
+    unsigned int hashBits = 4;
+    while ((1u << hashBits) < (unsigned int) wad->numLumps * 2) {
+        ++hashBits;
+    }
+    const unsigned int hashCapacity = 1u << hashBits;
+    wad->hashMask  = hashCapacity - 1;
+    wad->hashShift = 64 - hashBits;
+    wad->hashKeys  = (uint64_t *) calloc(hashCapacity, sizeof(uint64_t));
+    wad->hashLumps = (int *) malloc(hashCapacity * sizeof(int));
+    memset(wad->hashLumps, -1, hashCapacity * sizeof(int));
+    wad->labelMaps = (int *) malloc(((size_t) wad->numLumps + 1) * sizeof(int));
+    memset(wad->labelMaps, -1, ((size_t) wad->numLumps + 1) * sizeof(int));
+
+    uint64_t mapLumpKeys[NUM_MAP_LUMPS];
+    for (int type = LUMP_THINGS; type < NUM_MAP_LUMPS; ++type) {
+        mapLumpKeys[type] = getLumpKey(mapLumpNames[type]);
+    }
+
+    uint64_t *keys = (uint64_t *) malloc(((size_t) wad->numLumps + 1) * sizeof(uint64_t));
+    for (int i = 0; i < wad->numLumps; ++i) {
+        keys[i] = getLumpKey(wad->directory[i].name);
+
+        unsigned int slot = hashLumpKey(wad, keys[i]);
+        while (wad->hashLumps[slot] != -1 && wad->hashKeys[slot] != keys[i]) {
+            slot = (slot + 1) & wad->hashMask;
+        }
+        wad->hashKeys[slot] = keys[i];
+        wad->hashLumps[slot] = i;
+    }
+
+    // A map label is any lump immediately followed by THINGS,
+    // its group runs until the first lump that isn't a map lump
+    int mapsCapacity = 0;
+    for (int i = 0; i + 1 < wad->numLumps; ++i) {
+        if (keys[i + 1] != mapLumpKeys[LUMP_THINGS]) continue;
+
+        if (wad->numMaps == mapsCapacity) {
+            mapsCapacity = (mapsCapacity == 0) ? 16 : mapsCapacity * 2;
+            wad->maps = (wadmap_t *) realloc(wad->maps, mapsCapacity * sizeof(wadmap_t));
+        }
+        wadmap_t *map = &wad->maps[wad->numMaps++];
+        memset(map->lumps, -1, sizeof(map->lumps));
+        memset(map->name, 0, sizeof(map->name));
+        memcpy(map->name, &keys[i], 8);
+        map->lumps[LUMP_LABEL] = i;
+        wad->labelMaps[i] = wad->numMaps - 1;
+
+        int j = i + 1;
+        for (; j < wad->numLumps; ++j) {
+            int type = LUMP_THINGS;
+            while (type < NUM_MAP_LUMPS && keys[j] != mapLumpKeys[type]) {
+                ++type;
+            }
+            if (type == NUM_MAP_LUMPS || map->lumps[type] != -1) break;
+            map->lumps[type] = j;
+        }
+        i = j - 1;
+    }
+    free(keys);
+
+    LOG_DEBUG("Indexed %d lumps, %d maps", wad->numLumps, wad->numMaps);
+}
@@ -0,0 +1,85 @@
+#ifndef SERAPH_WAD_H
+#define SERAPH_WAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../common.h"
+
+/*
+ * https://zdoom.org/wiki/WAD
+ */
+
+// WAD file header
+typedef struct {
+    char identification[4]; // "IWAD" or "PWAD"
+    int numLumps;
+    int infoTableOffset;
+} wadinfo_t;
+
+// WAD file lump info table entry
+typedef struct {
+    int filePos;
+    int size;
+    char name[8];
+} filelump_t;
+
+// Map level types, defined in the order of Lumps in a map WAD
+typedef enum {
+    LUMP_LABEL,    // a separator, name, ExMx or MAPxx
+    LUMP_THINGS,   // monsters, items, etc...
+    LUMP_LINEDEFS, // linedefs, from editing
+    LUMP_SIDEDEFS, // sidedefs, from editin
+    LUMP_VERTEXES, // vertices, edited and BSP splits generated
+    LUMP_SEGS,     // linesegs, from linedefs split by bsp
+    LUMP_SSECTORS, // subsectors, list of linesegs
+    LUMP_NODES,    // BSP nodes
+    LUMP_SECTORS,  // sectors, from editing
+    LUMP_REJECT,   // LUT, sector-sector visibility
+    LUMP_BLOCKMAP, // LUT, motion clippingg, walls/grid element
+    NUM_MAP_LUMPS
+} MapLevelType;
+
+// A validated, in-place view of a single lump's data
+typedef struct {
+    const filelump_t *lump;
+    const unsigned char *data;
+    size_t size;
+} lumpview_t;
+
+// Directory index entry for a single map,
+// the directory index of each of its lumps or -1 if missing
+typedef struct {
+    char name[9];
+    int lumps[NUM_MAP_LUMPS];
+} wadmap_t;
+
+// An open WAD file, memory mapped for its whole lifetime
+typedef struct {
+    const char *fileName;
+    MappedFile *file;
+    wadinfo_t info;
+    int numLumps;
+    filelump_t *directory;
+    // Open addressing hash of lump name -> directory index
+    unsigned int hashMask;
+    unsigned int hashShift;
+    uint64_t *hashKeys;
+    int *hashLumps;
+    // Map lump groups, in directory order
+    int numMaps;
+    wadmap_t *maps;
+    int *labelMaps; // directory index -> index of the map it labels, or -1
+} wad_t;
+
+wad_t *openWad(const char *fileName);
+void closeWad(wad_t *wad);
+bool getWadLumpView(const wad_t *wad, int index, lumpview_t *view);
+
+uint64_t getLumpKey(const char *name);
+int findWadLump(const wad_t *wad, const char *name);
+const wadmap_t *findWadMap(const wad_t *wad, const char *name);
+const char *getMapLumpName(MapLevelType type);
+
+#endif //SERAPH_WAD_H
@@ -0,0 +1,167 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "entity_store.h"
+#include "common.h"
+
+static void growEntityStore(EntityStore *store, int capacity) {
+    const size_t n = (size_t) capacity;
+    store->x         = (float *) realloc(store->x, n * sizeof(float));
+    store->y         = (float *) realloc(store->y, n * sizeof(float));
+    store->angle     = (float *) realloc(store->angle, n * sizeof(float));
+    store->facing    = (unsigned char *) realloc(store->facing, n * sizeof(unsigned char));
+    store->animation = (unsigned short *) realloc(store->animation, n * sizeof(unsigned short));
+    store->stateTime = (float *) realloc(store->stateTime, n * sizeof(float));
+    store->keyframe  = (const TextureRegion **) realloc(store->keyframe, n * sizeof(TextureRegion *));
+    store->handle    = (EntityHandle *) realloc(store->handle, n * sizeof(EntityHandle));
+    // Never fewer slots than entities, so there's always one free for a new entity
+    store->slotIndex      = (int *) realloc(store->slotIndex, n * sizeof(int));
+    store->slotGeneration = (Uint16 *) realloc(store->slotGeneration, n * sizeof(Uint16));
+    store->freeSlots      = (int *) realloc(store->freeSlots, n * sizeof(int));
+    store->capacity = capacity;
+}
+
+EntityStore *createEntityStore(Animation **animations, int numAnimations, int capacity) {
+    assert(animations != NULL && numAnimations > 0 && capacity > 0);
+
+    EntityStore *store = (EntityStore *) calloc(1, sizeof(EntityStore));
+    store->animations = animations;
+    store->numAnimations = numAnimations;
+    growEntityStore(store, MIN(capacity, ENTITY_MAX_SLOTS));
+    return store;
+}
+
+//
+// Add an entity facing right, at a map position and a time into one of the store's animations
+//
+EntityHandle createEntity(EntityStore *store, float x, float y, int animation, float stateTime) {
+    assert(store != NULL && animation >= 0 && animation < store->numAnimations);
+
+    if (store->count == store->capacity) {
+        if (store->capacity == ENTITY_MAX_SLOTS) return ENTITY_NONE;
+        growEntityStore(store, MIN(2 * store->capacity, ENTITY_MAX_SLOTS));
+    }
+
+    // Freed slots first, so slots stay dense and generations go round slowly
+    int slot;
+    if (store->numFreeSlots > 0) {
+        slot = store->freeSlots[--store->numFreeSlots];
+    } else {
+        slot = store->numSlots++;
+        store->slotGeneration[slot] = 0;
+    }
+    store->slotGeneration[slot] = (Uint16) (store->slotGeneration[slot] % ENTITY_MAX_GENERATION + 1);
+    const EntityHandle handle = ((EntityHandle) store->slotGeneration[slot] << ENTITY_SLOT_BITS) | (EntityHandle) slot;
+
+    const int i = store->count++;
+    store->slotIndex[slot] = i;
+    store->x[i] = x;
+    store->y[i] = y;
+    store->angle[i] = 0.f;
+    store->facing[i] = RIGHT;
+    store->animation[i] = (unsigned short) animation;
+    store->stateTime[i] = stateTime;
+    store->keyframe[i] = getAnimationKeyFrame(store->animations[animation], stateTime);
+    store->handle[i] = handle;
+    return handle;
+}
+
+//
+// Where an entity is packed, -1 if the handle's entity has been destroyed
+//
+int getEntityIndex(const EntityStore *store, EntityHandle handle) {
+    assert(store != NULL);
+
+    const int slot = (int) (handle & (ENTITY_MAX_SLOTS - 1));
+    const Uint16 generation = (Uint16) (handle >> ENTITY_SLOT_BITS);
+    if (handle == ENTITY_NONE || slot >= store->numSlots || store->slotGeneration[slot] != generation) return -1;
+    return store->slotIndex[slot];
+}
+
+void destroyEntity(EntityStore *store, EntityHandle handle) {
+    assert(store != NULL);
+
+    const int i = getEntityIndex(store, handle);
+    if (i < 0) return;
+
+    // The last entity fills the hole
+    const int last = --store->count;
+    if (i != last) {
+        store->x[i] = store->x[last];
+        store->y[i] = store->y[last];
+        store->angle[i] = store->angle[last];
+        store->facing[i] = store->facing[last];
+        store->animation[i] = store->animation[last];
+        store->stateTime[i] = store->stateTime[last];
+        store->keyframe[i] = store->keyframe[last];
+        store->handle[i] = store->handle[last];
+        store->slotIndex[store->handle[i] & (ENTITY_MAX_SLOTS - 1)] = i;
+    }
+
+    const int slot = (int) (handle & (ENTITY_MAX_SLOTS - 1));
+    store->slotIndex[slot] = -1;
+    store->freeSlots[store->numFreeSlots++] = slot;
+}
+
+//
+// Destroy every entity, their handles all stop finding anything
+//
+void clearEntities(EntityStore *store) {
+    assert(store != NULL);
+
+    for (int i = 0; i < store->count; ++i) {
+        const int slot = (int) (store->handle[i] & (ENTITY_MAX_SLOTS - 1));
+        store->slotIndex[slot] = -1;
+        store->freeSlots[store->numFreeSlots++] = slot;
+    }
+    store->count = 0;
+}
+
+//
+// Advance every entity's animation, returns how many changed keyframe
+//
+int updateEntities(EntityStore *store, float delta) {
+    assert(store != NULL);
+
+    Animation **animations = store->animations;
+    int changed = 0;
+    for (int i = 0; i < store->count; ++i) {
+        store->stateTime[i] += delta;
+        const TextureRegion *keyframe = getAnimationKeyFrame(animations[store->animation[i]], store->stateTime[i]);
+        changed += (keyframe != store->keyframe[i]);
+        store->keyframe[i] = keyframe;
+    }
+    return changed;
+}
+
+//
+// Seconds until any entity's keyframe next changes, negative if none ever will
+//
+float getEntitiesTimeToNextFrame(const EntityStore *store) {
+    assert(store != NULL);
+
+    float soonest = -1.f;
+    for (int i = 0; i < store->count; ++i) {
+        const float wait = getAnimationTimeToNextFrame(store->animations[store->animation[i]], store->stateTime[i]);
+        if (wait >= 0.f && (soonest < 0.f || wait < soonest)) {
+            soonest = wait;
+        }
+    }
+    return soonest;
+}
+
+void destroyEntityStore(EntityStore *store) {
+    if (store == NULL) return;
+    free(store->x);
+    free(store->y);
+    free(store->angle);
+    free(store->facing);
+    free(store->animation);
+    free(store->stateTime);
+    free(store->keyframe);
+    free(store->handle);
+    free(store->slotIndex);
+    free(store->slotGeneration);
+    free(store->freeSlots);
+    free(store);
+}
@@ -0,0 +1,53 @@
+#ifndef SERAPH_ENTITY_STORE_H
+#define SERAPH_ENTITY_STORE_H
+
+#include "SDL.h"
+
+#include "animation.h"
+#include "sprite.h"
+#include "texture_region.h"
+
+// A handle is a slot and the generation of the entity in it, so a handle to a destroyed
+// entity never finds the one that took its slot. 0 is never a handle.
+typedef Uint32 EntityHandle;
+
+#define ENTITY_NONE 0
+#define ENTITY_SLOT_BITS 20
+#define ENTITY_MAX_SLOTS (1 << ENTITY_SLOT_BITS)
+#define ENTITY_MAX_GENERATION ((1 << (32 - ENTITY_SLOT_BITS)) - 1)
+
+// Animated sprites stored as parallel arrays, so updating and drawing them streams through
+// memory rather than chasing a pointer per sprite. Index i is the same entity in every array.
+// Destroying an entity moves the last one into its place, handles find them wherever they are.
+typedef struct EntityStore {
+    Animation **animations; // what the animation indices index
+    int numAnimations;
+    int count;
+    int capacity;
+    // Packed
+    float *x; // map units, the center of the sprite
+    float *y;
+    float *angle; // degrees clockwise
+    unsigned char *facing; // enum Facing
+    unsigned short *animation;
+    float *stateTime;
+    const TextureRegion **keyframe; // for the state time
+    EntityHandle *handle;
+    // By slot, where its entity is packed, -1 while the slot is free
+    int numSlots;
+    int *slotIndex;
+    Uint16 *slotGeneration;
+    int numFreeSlots;
+    int *freeSlots;
+} EntityStore;
+
+EntityStore *createEntityStore(Animation **animations, int numAnimations, int capacity);
+EntityHandle createEntity(EntityStore *store, float x, float y, int animation, float stateTime);
+void destroyEntity(EntityStore *store, EntityHandle handle);
+int getEntityIndex(const EntityStore *store, EntityHandle handle);
+void clearEntities(EntityStore *store);
+int updateEntities(EntityStore *store, float delta);
+float getEntitiesTimeToNextFrame(const EntityStore *store);
+void destroyEntityStore(EntityStore *store);
+
+#endif //SERAPH_ENTITY_STORE_H
@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "SDL_atomic.h"
+
+#include "log.h"
+#include "common.h"
+
+#define LOG_BUFFER_SIZE 16384
+#define LOG_MESSAGE_SIZE 1024
+
+static const char *logLevelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR" };
+
+// Messages may come from worker threads, everything below is guarded by this
+static SDL_SpinLock logLock = 0;
+
+static struct {
+    int level;
+    size_t length;
+    char buffer[LOG_BUFFER_SIZE];
+    // Rate limiting window
+    uint64_t windowStart;
+    int windowCount;
+    int suppressed;
+} logState = {
+        .level = LOG_LEVEL_INFO,
+        .length = 0,
+        .windowStart = 0,
+        .windowCount = 0,
+        .suppressed = 0
+};
+
+void setLogLevel(int level) {
+    logState.level = level;
+}
+
+int getLogLevel() {
+    return logState.level;
+}
+
+static void flushLogBuffer() {
+    if (logState.length == 0) return;
+    fwrite(logState.buffer, 1, logState.length, stdout);
+    fflush(stdout);
+    logState.length = 0;
+}
+
+static void appendLog(const char *message, size_t length) {
+    if (logState.length + length > LOG_BUFFER_SIZE) {
+        flushLogBuffer();
+    }
+    memcpy(logState.buffer + logState.length, message, length);
+    logState.length += length;
+}
+
+void logMessage(int level, const char *format, ...) {
+    if (level < logState.level) return;
+
+    // Format outside the lock, it's the expensive part
+    char message[LOG_MESSAGE_SIZE];
+    int length = snprintf(message, sizeof(message), "[%s] ", logLevelNames[level]);
+
+    va_list args;
+    va_start(args, format);
+    int formatted = vsnprintf(message + length, sizeof(message) - length - 1, format, args);
+    va_end(args);
+
+    // Truncate messages that don't fit, always terminating with a newline
+    length = MIN(length + MAX(formatted, 0), (int) sizeof(message) - 2);
+    message[length++] = '\n';
+
+    SDL_AtomicLock(&logLock);
+    {
+        // Drop chatty messages past the rate limit, but never warnings or errors
+        bool dropped = false;
+        if (level < LOG_LEVEL_WARN) {
+            const uint64_t now = getMicroseconds();
+            if (now - logState.windowStart >= 1000000) {
+                if (logState.suppressed > 0) {
+                    char notice[64];
+                    int noticeLength = snprintf(notice, sizeof(notice), "[WARN] %d log messages suppressed\n", logState.suppressed);
+                    appendLog(notice, (size_t) MIN(noticeLength, (int) sizeof(notice) - 1));
+                }
+                logState.windowStart = now;
+                logState.windowCount = 0;
+                logState.suppressed = 0;
+            }
+            if (++logState.windowCount > LOG_RATE_LIMIT) {
+                ++logState.suppressed;
+                dropped = true;
+            }
+        }
+
+        if (!dropped) {
+            appendLog(message, (size_t) length);
+            if (level >= LOG_LEVEL_WARN) {
+                flushLogBuffer();
+            }
+        }
+    }
+    SDL_AtomicUnlock(&logLock);
+}
+
+void flushLog() {
+    SDL_AtomicLock(&logLock);
+    flushLogBuffer();
+    SDL_AtomicUnlock(&logLock);
+}
@@ -1,14 +1,26 @@
+#include <assert.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
 #define SDL_MAIN_HANDLED
 #include "SDL.h"
 
+#include "bench.h"
+#include "common.h"
+#include "render_commands.h"
+#include "renderer.h"
 #include "sprite.h"
+#include "sprite_batch.h"
+#include "entity_store.h"
 #include "animation.h"
 #include "assets.h"
 #include "doom/doom_utils.h"
+#include "map_loader.h"
+#include "map_cache.h"
+#include "map_view.h"
 #include "camera.h"
+#include "log.h"
 
 #define SCREEN_TITLE "Seraph"
 #define SCREEN_WIDTH 640
@@ -16,21 +28,73 @@
 #define SCREEN_FLAGS (SDL_WINDOW_RESIZABLE)
 #define RENDER_FLAGS (SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC)
 
+#define WAD_PATH "data/doom1.wad"
+#define ASSETS_PATH "data/assets.json"
+
+// The simulation steps at Doom's tic rate whatever the display refreshes at,
+// frames draw between the last two steps
+#define TICK_RATE 35
+#define TICK_TIME (1.0 / TICK_RATE)
+// Longer frames, like a stall in a debugger, are dropped instead of caught up on
+#define MAX_FRAME_TIME 0.25
+// Longest sleep between checks for a finished map load while the window is hidden or nothing animates
+#define IDLE_TIMEOUT 250
+
+#define MAP_CACHE_BUDGET (64 * 1024 * 1024)
+#define SPRITE_BATCH_SIZE 1024
+#define RENDER_COMMANDS_SIZE 64
+#define ENTITY_STORE_SIZE 1024
+
+// Creatures are drawn this many map units to a sprite pixel, a 16 pixel creature is about as wide as a Doom monster.
+// Zoomed out they're never smaller than a quarter of their pixel size, so they can still be told apart.
+#define ENTITY_TEXEL_SIZE 2.5f
+#define ENTITY_MIN_SCALE 0.25f
+
 SDL_MessageBoxButtonData *msgBoxButtons = NULL;
 
-int mapMinX = INT32_MAX;
-int mapMinY = INT32_MAX;
-int mapMaxX = INT32_MIN;
-int mapMaxY = INT32_MIN;
-int mapScale = 8;
+// Pixels per map unit the view starts at
+#define MAP_DEFAULT_ZOOM (1.f / 8.f)
+
+// Input events() hands the update thread, applied before its next ticks
+#define INPUT_QUEUE_SIZE 64
+
+typedef enum InputType {
+    INPUT_PAN,            // drag the view, in pixels
+    INPUT_ZOOM,           // by a factor around a screen position
+    INPUT_NEXT_ANIMATION,
+    INPUT_SET_MAP         // center the view on a map and spawn its creatures
+} InputType;
+
+typedef struct InputEvent {
+    InputType type;
+    union {
+        struct {
+            float dx;
+            float dy;
+        } pan;
+        struct {
+            float factor;
+            float x;
+            float y;
+        } zoom;
+        struct {
+            const map_t *map;
+            unsigned long mapSwitch;
+            int viewWidth;
+            int viewHeight;
+        } map;
+    } u;
+} InputEvent;
 
 typedef struct Game {
     bool running;
 
     struct {
-        Uint64 now;
+        Uint64 now;         // microseconds
         Uint64 prev;
-        double delta;
+        double delta;       // seconds since the last frame
+        double accumulator; // seconds not simulated yet
+        unsigned long ticks;
     } timer;
 
     struct {
@@ -39,14 +103,27 @@ typedef struct Game {
         unsigned int height;
         unsigned int windowFlags;
         unsigned int renderFlags;
+        bool software;
+        bool onDemand; // only draw frames that changed
+        bool visible;
+        bool dirty;    // something changed that the last frame didn't show
+        unsigned long drawnSequence;
+        double drawnAlpha;
         SDL_Window *window;
-        SDL_Renderer *renderer;
+        Renderer *renderer;
     } screen;
 
     struct {
         Sprite *sprite;
+        double prevSpriteAngle;
+        SpriteBatch *spriteBatch;
         size_t animIndex;
         float animStateTime;
+        EntityStore *entities; // the map's creatures
+        // Screen positions of the entities being drawn, the render thread's like the batch
+        int maxEntityPositions;
+        float *entityScreenX;
+        float *entityScreenY;
     } graphics;
 
     struct {
@@ -54,12 +131,58 @@ typedef struct Game {
         bool rightDown;
     } mouse;
 
+    // The simulation runs on the update thread, which hands the render thread what to draw as
+    // command lists. The render thread, the main one, owns the renderer and pumps events,
+    // queueing input for the update thread rather than touching the simulation.
+    struct {
+        SDL_Thread *thread;
+        SDL_mutex *lock; // guards the input queue and quit, only ever held to hand them over
+        SDL_cond *wake;
+        Uint32 frameEvent; // pushed when a list is published, so the render thread stops waiting
+        CommandBuffer *commands;
+        bool quit;
+        bool changed; // since the last list was published
+    } update;
+
+    struct {
+        Uint8 keyboardState[SDL_NUM_SCANCODES]; // the update thread's copy
+        // Queued under the lock
+        Uint8 queuedKeyboardState[SDL_NUM_SCANCODES]; // copied from SDL's where events are pumped
+        int numQueued;
+        InputEvent queue[INPUT_QUEUE_SIZE];
+    } input;
+
     struct {
+        const map_t *map; // the update thread's, game.map is the one switched to last
+        unsigned long mapSwitch;
         Camera camera;
+        Camera prevCamera; // at the previous tick
     } view;
 
-    map_t *map;
-    maplumps_t *maplumps;
+    struct {
+        const char *wad;
+        const char *assets;
+    } paths;
+
+    struct {
+        bool enabled;
+        BenchOptions options;
+        Bench *bench;
+    } bench;
+
+    wad_t *wad;
+    MapLoader *mapLoader;
+    MapCache *mapCache;
+    map_t *map; // switched to last
+    MapView *mapView;
+    // Maps switched to that the view hasn't drawn yet, oldest first. Lists in the command buffer can
+    // point at these or the view's map, so all of them are pinned in the cache.
+    unsigned long mapSwitches;
+    unsigned long shownMapSwitch; // the view's map, switchedMaps[i] is switch shownMapSwitch + 1 + i
+    int numSwitchedMaps;
+    int maxSwitchedMaps;
+    const map_t **switchedMaps;
+    maplumps_t maplumps;
     int currentMap;
 
     Assets *assets;
@@ -72,7 +195,9 @@ Game game = {
         {
                 .now = 0,
                 .prev = 0,
-                .delta = 0.0
+                .delta = 0.0,
+                .accumulator = 0.0,
+                .ticks = 0
         },
         {
                 .title = SCREEN_TITLE,
@@ -80,86 +205,245 @@ Game game = {
                 .height = SCREEN_HEIGHT,
                 .windowFlags = SCREEN_FLAGS,
                 .renderFlags = RENDER_FLAGS,
+                .software = false,
+                .onDemand = true,
+                .visible = true,
+                .dirty = true,
+                .drawnSequence = 0,
+                .drawnAlpha = 0.0,
                 .window = NULL,
                 .renderer = NULL,
         },
         {
                 .sprite = NULL,
+                .prevSpriteAngle = 0.0,
+                .spriteBatch = NULL,
                 .animIndex = 0,
                 .animStateTime = 0.f,
+                .entities = NULL,
+                .maxEntityPositions = 0,
+                .entityScreenX = NULL,
+                .entityScreenY = NULL,
         },
         {
                 .leftDown = false,
                 .rightDown = false
         },
+        .wad = NULL,
+        .mapLoader = NULL,
+        .mapCache = NULL,
         .map = NULL,
-        .maplumps = NULL,
+        .mapView = NULL,
+        .mapSwitches = 0,
+        .shownMapSwitch = 0,
+        .numSwitchedMaps = 0,
+        .maxSwitchedMaps = 0,
+        .switchedMaps = NULL,
+        .maplumps = { 0, NULL },
+        .update = {
+                .thread = NULL,
+                .lock = NULL,
+                .wake = NULL,
+                .frameEvent = 0,
+                .commands = NULL,
+                .quit = false,
+                .changed = true
+        },
         .currentMap = -1,
-        .assets = NULL
+        .assets = NULL,
+        .paths = {
+                .wad = WAD_PATH,
+                .assets = ASSETS_PATH
+        },
+        .bench = {
+                .enabled = false,
+                .options = {
+                        .mapName = NULL,
+                        .frames = BENCH_DEFAULT_FRAMES,
+                        .dumpDir = NULL,
+                        .dumpEvery = 1
+                },
+                .bench = NULL
+        }
 };
 
 // ----------------------------------------------------------------------------
 
+void parseArgs(int argc, char **argv);
 void init();
 void initAssets();
+void startUpdateThread();
+void stopUpdateThread();
+int runUpdateThread(void *data);
+Uint32 getUpdateTimeout();
+bool isInputHeld();
 void events();
+void queueInput(const InputEvent *input);
+void applyQueuedInput();
+void applyInput(const InputEvent *input);
+void logStats();
+Uint32 getIdleTimeout();
+bool isSceneMoving();
+void runFrame();
 void update();
+void updateAnimation(double delta);
 void updateTimer();
-void render();
+void updateMap();
+void setCurrentMap(map_t *map);
+void showSwitchedMap(unsigned long mapSwitch);
+void spawnMapCreatures(const map_t *map);
+void publishRenderCommands();
+void buildRenderCommands(RenderCommandList *list);
+void render(const RenderCommandList *list, double alpha);
+void submitEntities(const RenderEntities *entities, const Camera *camera);
+void runBench();
 void shutdown();
 
 void showMapSelectDialog();
 
 // ----------------------------------------------------------------------------
 
+void parseArgs(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        // Rasterize on the CPU instead of through SDL's renderer
+        if (strcmp(arg, "--software") == 0) game.screen.software = true;
+        // Draw every frame, whether anything changed or not
+        else if (strcmp(arg, "--continuous") == 0) game.screen.onDemand = false;
+        // Draw a scripted camera path offscreen and report what the frames cost
+        else if (strcmp(arg, "--bench") == 0) game.bench.enabled = true;
+        else if (value == NULL) SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Ignoring argument '%s'", arg);
+        else {
+            if      (strcmp(arg, "--wad") == 0)        game.paths.wad = value;
+            else if (strcmp(arg, "--assets") == 0)     game.paths.assets = value;
+            else if (strcmp(arg, "--map") == 0)        game.bench.options.mapName = value;
+            else if (strcmp(arg, "--frames") == 0)     game.bench.options.frames = MAX(atoi(value), 1);
+            else if (strcmp(arg, "--dump") == 0)       game.bench.options.dumpDir = value;
+            else if (strcmp(arg, "--dump-every") == 0) game.bench.options.dumpEvery = MAX(atoi(value), 1);
+            else {
+                SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Ignoring argument '%s'", arg);
+                continue;
+            }
+            ++i;
+        }
+    }
+}
+
 void init() {
     atexit(shutdown);
 
-    Uint32 sdlFlags = SDL_INIT_EVERYTHING;
+    // Benchmarks only need the timer, they never open a window
+    Uint32 sdlFlags = game.bench.enabled ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING;
     if (SDL_Init(sdlFlags)) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to initialize SDL: %s", SDL_GetError());
         exit(1);
     }
 
-    game.screen.window = SDL_CreateWindow(game.screen.title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                          game.screen.width, game.screen.height, game.screen.windowFlags);
-    if (game.screen.window == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create window: %s", SDL_GetError());
-        exit(1);
+    if (game.bench.enabled) {
+        // Offscreen and on the CPU, so runs compare on any machine, GPU or not
+        game.screen.renderer = createSoftwareRenderer(NULL, game.screen.width, game.screen.height);
+        game.bench.bench = createBench(&game.bench.options, game.screen.width, game.screen.height);
+    } else {
+        game.screen.window = SDL_CreateWindow(game.screen.title, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                              game.screen.width, game.screen.height, game.screen.windowFlags);
+        if (game.screen.window == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create window: %s", SDL_GetError());
+            exit(1);
+        }
+
+        if (game.screen.software) {
+            game.screen.renderer = createSoftwareRenderer(game.screen.window, game.screen.width, game.screen.height);
+        } else {
+            game.screen.renderer = createRenderer(game.screen.window, game.screen.renderFlags);
+        }
     }
 
-    game.screen.renderer = SDL_CreateRenderer(game.screen.window, -1, game.screen.renderFlags);
-    if (game.screen.renderer == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create renderer: %s", SDL_GetError());
+    game.update.lock = SDL_CreateMutex();
+    game.update.wake = SDL_CreateCond();
+    game.update.commands = createCommandBuffer(RENDER_COMMANDS_SIZE);
+    if (game.update.lock == NULL || game.update.wake == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create update lock: %s", SDL_GetError());
         exit(1);
     }
 
+    setCamera(&game.view.camera, 0.f, 0.f, MAP_DEFAULT_ZOOM);
+    game.view.prevCamera = game.view.camera;
+
     initAssets();
     updateTimer();
 
+    // Benchmarks simulate and draw in step on this thread
+    if (!game.bench.enabled) {
+        startUpdateThread();
+    }
+
     game.running = true;
 }
 
 void initAssets() {
-    game.assets = loadAssets("data/assets.json", game.screen.renderer);
+    game.assets = loadAssets(game.paths.assets, game.screen.renderer);
+
+    game.wad = openWad(game.paths.wad);
+    if (game.wad == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to open WAD '%s'", game.paths.wad);
+        exit(1);
+    }
 
-    game.maplumps = initMapLumps(10);
-    readWadMaps("data/doom1.wad", game.maplumps);
+    readWadMaps(game.wad, &game.maplumps);
+    game.mapLoader = createMapLoader(game.wad);
+    game.mapCache = createMapCache(MAP_CACHE_BUDGET);
+    game.mapView = createMapView(game.screen.renderer);
 
-    TextureRegion *spriteRegion = createTextureRegion(game.assets->spritesheets[0], 0, 0, 24, 24);
+    // Spritesheets are only drawn from through the atlas, start on the first animation's first frame
+    TextureRegion *spriteRegion = game.assets->animations[0]->keyframes[0];
     game.graphics.sprite = createSpriteWithBounds(spriteRegion, 0, 0, 96, 96);
+    game.graphics.spriteBatch = createSpriteBatch(game.screen.renderer, SPRITE_BATCH_SIZE);
+    game.graphics.entities = createEntityStore(game.assets->animations, (int) game.assets->numAnimations,
+                                               ENTITY_STORE_SIZE);
 }
 
 void events() {
+    // Sleep until there's input, or until the scene changes by itself
+    const Uint32 timeout = getIdleTimeout();
+    if (timeout > 0) {
+        SDL_WaitEventTimeout(NULL, (int) timeout);
+    }
+
     int x = 0;
     int y = 0;
     SDL_GetMouseState(&x, &y);
 
+    int numEvents = 0;
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
+        ++numEvents;
         switch (event.type) {
             // System ---------------------------------
             case SDL_QUIT: game.running = false; break;
+            case SDL_WINDOWEVENT: {
+                switch (event.window.event) {
+                    case SDL_WINDOWEVENT_SIZE_CHANGED: {
+                        resizeRenderer(game.screen.renderer, event.window.data1, event.window.data2);
+                        game.screen.dirty = true;
+                    } break;
+                    // Nothing is drawn while the window can't be seen
+                    case SDL_WINDOWEVENT_HIDDEN:
+                    case SDL_WINDOWEVENT_MINIMIZED: game.screen.visible = false; break;
+                    case SDL_WINDOWEVENT_SHOWN:
+                    case SDL_WINDOWEVENT_RESTORED:
+                    case SDL_WINDOWEVENT_MAXIMIZED: game.screen.visible = true; game.screen.dirty = true; break;
+                    case SDL_WINDOWEVENT_EXPOSED: game.screen.dirty = true; break;
+                    default: break;
+                }
+            } break;
+            // Render targets lose their contents when the device is reset
+            case SDL_RENDER_TARGETS_RESET:
+            case SDL_RENDER_DEVICE_RESET: {
+                invalidateMapViewTiles(game.mapView);
+                game.screen.dirty = true;
+            } break;
             // Keyboard -------------------------------
             case SDL_KEYDOWN: {
                 // ...
@@ -169,24 +453,38 @@ void events() {
                     game.running = false;
                 }
                 if (event.key.keysym.sym == SDLK_SPACE) {
-                    game.graphics.animIndex = (game.graphics.animIndex + 1) % game.assets->numAnimations;
+                    const InputEvent input = { .type = INPUT_NEXT_ANIMATION };
+                    queueInput(&input);
                 }
                 if (event.key.keysym.sym == SDLK_TAB) {
                     showMapSelectDialog();
                 }
 
-                if      (event.key.keysym.sym == SDLK_z) { if (++mapScale > 15) mapScale = 15; }
-                else if (event.key.keysym.sym == SDLK_x) { if (--mapScale < 1) mapScale = 1; }
+                if (event.key.keysym.sym == SDLK_z || event.key.keysym.sym == SDLK_x) {
+                    int width, height;
+                    getRendererSize(game.screen.renderer, &width, &height);
+                    const float factor = (event.key.keysym.sym == SDLK_x) ? CAMERA_ZOOM_STEP : 1.f / CAMERA_ZOOM_STEP;
+                    const InputEvent input = {
+                            .type = INPUT_ZOOM,
+                            .u.zoom = { factor, 0.5f * (float) width, 0.5f * (float) height }
+                    };
+                    queueInput(&input);
+                }
 
                 if (event.key.keysym.sym == SDLK_RETURN) {
-                    printf("Camera: (%d, %d)\n", game.view.camera.x, game.view.camera.y);
-                    printf("Map extents: min(%d, %d) max(%d, %d) scale = %d\n", mapMinX, mapMinY, mapMaxX, mapMaxY, mapScale);
+                    logStats();
                 }
             } break;
             // Mouse ----------------------------------
             case SDL_MOUSEWHEEL: {
-                if (event.wheel.y > 0) { if (--mapScale < 1) mapScale = 1; }
-                if (event.wheel.y < 0) { if (++mapScale > 15) mapScale = 15; }
+                // A step a notch, around the map point under the cursor
+                if (event.wheel.y != 0) {
+                    const InputEvent input = {
+                            .type = INPUT_ZOOM,
+                            .u.zoom = { (float) SDL_pow(CAMERA_ZOOM_STEP, event.wheel.y), (float) x, (float) y }
+                    };
+                    queueInput(&input);
+                }
             } break;
             case SDL_MOUSEBUTTONDOWN: {
                 if (event.button.button == SDL_BUTTON_LEFT)  game.mouse.leftDown  = true;
@@ -202,20 +500,284 @@ void events() {
             } break;
             case SDL_MOUSEMOTION: {
                 if (game.mouse.leftDown) {
-                    game.view.camera.x -= event.motion.xrel;
-                    game.view.camera.y -= event.motion.yrel;
+                    const InputEvent input = {
+                            .type = INPUT_PAN,
+                            .u.pan = { (float) -event.motion.xrel, (float) -event.motion.yrel }
+                    };
+                    queueInput(&input);
                 }
             } break;
             default: break;
         }
     }
+    if (numEvents == 0) return;
+
+    // Let the update thread see the keys held right away rather than at its next tick
+    SDL_LockMutex(game.update.lock);
+    {
+        SDL_memcpy(game.input.queuedKeyboardState, SDL_GetKeyboardState(NULL), sizeof(game.input.queuedKeyboardState));
+        SDL_CondSignal(game.update.wake);
+    }
+    SDL_UnlockMutex(game.update.lock);
+}
+
+//
+// Hand input to the update thread and wake it, merging a run of drags into one pan
+//
+void queueInput(const InputEvent *input) {
+    SDL_LockMutex(game.update.lock);
+    {
+        InputEvent *last = (game.input.numQueued > 0) ? &game.input.queue[game.input.numQueued - 1] : NULL;
+        if (input->type == INPUT_PAN && last != NULL && last->type == INPUT_PAN) {
+            last->u.pan.dx += input->u.pan.dx;
+            last->u.pan.dy += input->u.pan.dy;
+        } else if (game.input.numQueued < INPUT_QUEUE_SIZE) {
+            game.input.queue[game.input.numQueued++] = *input;
+        } else {
+            LOG_WARN("Input queue full, dropping input %d", (int) input->type);
+        }
+        SDL_CondSignal(game.update.wake);
+    }
+    SDL_UnlockMutex(game.update.lock);
+}
+
+//
+// Apply the input queued since the last call, taking it from under the lock first
+// so events() is never kept waiting on the simulation
+//
+void applyQueuedInput() {
+    InputEvent input[INPUT_QUEUE_SIZE];
+    int numInput;
+    SDL_LockMutex(game.update.lock);
+    {
+        numInput = game.input.numQueued;
+        SDL_memcpy(input, game.input.queue, numInput * sizeof(InputEvent));
+        game.input.numQueued = 0;
+        SDL_memcpy(game.input.keyboardState, game.input.queuedKeyboardState, sizeof(game.input.keyboardState));
+    }
+    SDL_UnlockMutex(game.update.lock);
+
+    for (int i = 0; i < numInput; ++i) {
+        applyInput(&input[i]);
+    }
+}
+
+void applyInput(const InputEvent *input) {
+    switch (input->type) {
+        case INPUT_PAN: {
+            // Dragging follows the mouse right away rather than from the next tick
+            panCamera(&game.view.camera, input->u.pan.dx, input->u.pan.dy);
+            panCamera(&game.view.prevCamera, input->u.pan.dx, input->u.pan.dy);
+        } break;
+        case INPUT_ZOOM: {
+            zoomCameraAt(&game.view.camera, input->u.zoom.factor, input->u.zoom.x, input->u.zoom.y);
+            zoomCameraAt(&game.view.prevCamera, input->u.zoom.factor, input->u.zoom.x, input->u.zoom.y);
+        } break;
+        case INPUT_NEXT_ANIMATION: {
+            game.graphics.animIndex = (game.graphics.animIndex + 1) % game.assets->numAnimations;
+        } break;
+        case INPUT_SET_MAP: {
+            // Shift camera so map is in view
+            const short *box = input->u.map.map->bounds.box;
+            centerCamera(&game.view.camera, 0.5f * (box[BOXLEFT] + box[BOXRIGHT]), 0.5f * (box[BOXBOTTOM] + box[BOXTOP]),
+                         input->u.map.viewWidth, input->u.map.viewHeight);
+            game.view.prevCamera = game.view.camera;
+            game.view.map = input->u.map.map;
+            game.view.mapSwitch = input->u.map.mapSwitch;
+            spawnMapCreatures(game.view.map);
+        } break;
+        default: return;
+    }
+    game.update.changed = true;
+}
+
+
+//
+// How long events() can sleep waiting for input, 0 while there's something to draw.
+// The update thread wakes it with an event when it publishes anything new.
+//
+Uint32 getIdleTimeout() {
+    if (!game.screen.visible) return IDLE_TIMEOUT;
+    if (!game.screen.onDemand || game.screen.dirty) return 0;
+
+    const RenderCommandList *list = acquireCommandList(game.update.commands);
+    if (list->changed && list->sequence != game.screen.drawnSequence) return 0;
+    if (list->moving && game.screen.drawnAlpha < 1.0) return 0;
+
+    // Poll a loading map a tick at a time
+    if (getMapLoadState(game.mapLoader) != MAP_LOAD_IDLE) return (Uint32) (TICK_TIME * 1000.0);
+    return IDLE_TIMEOUT;
+}
+
+//
+// Draw the newest command list, between its last two ticks, if it changed
+// anything and the window can be seen
+//
+void runFrame() {
+    updateMap();
+
+    const RenderCommandList *list = acquireCommandList(game.update.commands);
+    if (!game.screen.visible) return;
+
+    const double sincePublished = (double) (getMicroseconds() - list->time) * 0.000001;
+    const double alpha = MIN(list->alpha + sincePublished / TICK_TIME, 1.0);
+    if (game.screen.onDemand && !game.screen.dirty
+        && !(list->changed && list->sequence != game.screen.drawnSequence)
+        && !(list->moving && game.screen.drawnAlpha < 1.0)) {
+        return;
+    }
+
+    render(list, alpha);
+    game.screen.dirty = false;
+    game.screen.drawnSequence = list->sequence;
+    game.screen.drawnAlpha = alpha;
+}
+
+//
+// Log what's drawn and what drew it, the simulation's side as of the newest list it published
+//
+void logStats() {
+    const RenderCommandList *list = acquireCommandList(game.update.commands);
+    for (int i = 0; i < list->numCommands; ++i) {
+        if (list->commands[i].type != RENDER_MAP) continue;
+        const Camera *camera = &list->commands[i].u.map.camera;
+        LOG_INFO("Camera: (%.1f, %.1f) zoom %.4f", camera->x, camera->y, camera->zoom);
+    }
+    LOG_INFO("Timer: %lu ticks at %d Hz, last published %.3f ms ago", list->ticks, TICK_RATE,
+             (double) (getMicroseconds() - list->time) * 0.001);
+    LOG_INFO("Entities: %d", list->entities.count);
+    if (game.map != NULL) {
+        const short *box = game.map->bounds.box;
+        LOG_INFO("Map extents: min(%d, %d) max(%d, %d)", box[BOXLEFT], box[BOXBOTTOM], box[BOXRIGHT], box[BOXTOP]);
+    }
+    LOG_INFO("Map cache: %lu maps, %lu / %lu bytes, %lu hits, %lu misses, %lu evictions",
+             (unsigned long) game.mapCache->numEntries, (unsigned long) game.mapCache->usedBytes,
+             (unsigned long) game.mapCache->budgetBytes, game.mapCache->hits,
+             game.mapCache->misses, game.mapCache->evictions);
+    LOG_INFO("Map view: %lu transforms, %lu line batches, %lu tiles rendered, LOD level %d",
+             game.mapView->transforms, game.mapView->batches, game.mapView->tilesRendered, game.mapView->lodLevel);
+    LOG_INFO("Sprite batch: %d sprites drawn in %d draw calls",
+             game.graphics.spriteBatch->spritesDrawn, game.graphics.spriteBatch->drawCalls);
+    const RendererStats stats = game.screen.renderer->lastFrame;
+    LOG_INFO("Renderer: %s, %d draw calls, %d lines, %d rects, %d copies, %d triangles",
+             (game.screen.renderer->backend == RENDERER_SOFTWARE) ? "software" : "SDL",
+             stats.drawCalls, stats.lines, stats.rects, stats.copies, stats.triangles);
+}
+
+void startUpdateThread() {
+    game.update.frameEvent = SDL_RegisterEvents(1);
+    if (game.update.frameEvent == (Uint32) -1) {
+        game.update.frameEvent = 0;
+    }
+
+    game.update.thread = SDL_CreateThread(runUpdateThread, "Update", NULL);
+    if (game.update.thread == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create update thread: %s", SDL_GetError());
+        exit(1);
+    }
+}
+
+void stopUpdateThread() {
+    if (game.update.thread == NULL) return;
+
+    SDL_LockMutex(game.update.lock);
+    {
+        game.update.quit = true;
+        SDL_CondSignal(game.update.wake);
+    }
+    SDL_UnlockMutex(game.update.lock);
+    SDL_WaitThread(game.update.thread, NULL);
+    game.update.thread = NULL;
+}
+
+//
+// Simulate in fixed ticks as time passes, publishing what to draw whenever that changes.
+// The lock is only held to take the queued input and to wait for more.
+//
+int runUpdateThread(void *data) {
+    (void) data;
+
+    bool quit = false;
+    while (!quit) {
+        applyQueuedInput();
+
+        updateTimer();
+        game.timer.accumulator += game.timer.delta;
+        while (game.timer.accumulator >= TICK_TIME) {
+            update();
+            game.timer.accumulator -= TICK_TIME;
+        }
+
+        if (game.update.changed || isSceneMoving()) {
+            publishRenderCommands();
+        }
+
+        // Sleep until there's input, or until a tick would change anything
+        const Uint32 timeout = getUpdateTimeout();
+        SDL_LockMutex(game.update.lock);
+        {
+            if (game.input.numQueued == 0 && !game.update.quit) {
+                SDL_CondWaitTimeout(game.update.wake, game.update.lock, timeout);
+            }
+            quit = game.update.quit;
+        }
+        SDL_UnlockMutex(game.update.lock);
+    }
+    return 0;
+}
+
+//
+// How long the update thread can sleep before a tick would change anything.
+// An idle scene only has to wake up for the sprite's next keyframe.
+//
+Uint32 getUpdateTimeout() {
+    double wait = TICK_TIME - game.timer.accumulator;
+    if (!isSceneMoving() && !isInputHeld()) {
+        const Animation *animation = game.assets->animations[game.graphics.animIndex];
+        float untilNextFrame = getAnimationTimeToNextFrame(animation, game.graphics.animStateTime);
+        const float untilEntityFrame = getEntitiesTimeToNextFrame(game.graphics.entities);
+        if (untilEntityFrame >= 0.f && (untilNextFrame < 0.f || untilEntityFrame < untilNextFrame)) {
+            untilNextFrame = untilEntityFrame;
+        }
+        // Ticks that are already owed count towards the wait
+        wait = (untilNextFrame < 0.f) ? IDLE_TIMEOUT / 1000.0 : MAX(untilNextFrame - game.timer.accumulator, wait);
+    }
+    return MAX((Uint32) SDL_ceil(MIN(wait * 1000.0, IDLE_TIMEOUT)), 1u);
+}
+
+bool isInputHeld() {
+    const SDL_Scancode heldKeys[] = {
+            SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT, SDL_SCANCODE_UP, SDL_SCANCODE_DOWN,
+            SDL_SCANCODE_Q, SDL_SCANCODE_E, SDL_SCANCODE_W
+    };
+    for (size_t i = 0; i < SDL_arraysize(heldKeys); ++i) {
+        if (game.input.keyboardState[heldKeys[i]]) return true;
+    }
+    return false;
 }
 
+//
+// Whether the last tick moved anything, so frames until the next one draw in between
+//
+bool isSceneMoving() {
+    return !cameraEquals(&game.view.camera, &game.view.prevCamera)
+        || game.graphics.sprite->angle != game.graphics.prevSpriteAngle;
+}
+
+//
+// Advance the simulation one tick
+//
 void update() {
-    updateTimer();
+    // Whatever was moving last tick is drawn once more where it stopped
+    if (isSceneMoving()) {
+        game.update.changed = true;
+    }
+    game.view.prevCamera = game.view.camera;
+    game.graphics.prevSpriteAngle = game.graphics.sprite->angle;
+    game.timer.ticks++;
 
-    const Uint8 *keyboardState = SDL_GetKeyboardState(NULL);
-    const float speed = (float) (200 * game.timer.delta);
+    const Uint8 *keyboardState = game.input.keyboardState;
+    const float speed = (float) (200 * TICK_TIME);
 
 //    if (keyboardState[SDL_SCANCODE_LEFT]) {
 //        translateSprite(game.graphics.sprite, -speed, 0.f);
@@ -227,120 +789,347 @@ void update() {
 //    if      (keyboardState[SDL_SCANCODE_UP])   translateSprite(game.graphics.sprite, 0.f, -speed);
 //    else if (keyboardState[SDL_SCANCODE_DOWN]) translateSprite(game.graphics.sprite, 0.f,  speed);
 
-    if      (keyboardState[SDL_SCANCODE_LEFT])  game.view.camera.x += speed;
-    else if (keyboardState[SDL_SCANCODE_RIGHT]) game.view.camera.x -= speed;
+    if      (keyboardState[SDL_SCANCODE_LEFT])  panCamera(&game.view.camera,  speed, 0.f);
+    else if (keyboardState[SDL_SCANCODE_RIGHT]) panCamera(&game.view.camera, -speed, 0.f);
 
-    if      (keyboardState[SDL_SCANCODE_UP])   game.view.camera.y += speed;
-    else if (keyboardState[SDL_SCANCODE_DOWN]) game.view.camera.y -= speed;
+    if      (keyboardState[SDL_SCANCODE_UP])   panCamera(&game.view.camera, 0.f,  speed);
+    else if (keyboardState[SDL_SCANCODE_DOWN]) panCamera(&game.view.camera, 0.f, -speed);
 
     if      (keyboardState[SDL_SCANCODE_Q]) rotateSprite(game.graphics.sprite, -speed);
     else if (keyboardState[SDL_SCANCODE_E]) rotateSprite(game.graphics.sprite,  speed);
     else if (keyboardState[SDL_SCANCODE_W]) game.graphics.sprite->angle = 0.0;
 
-    game.graphics.animStateTime += game.timer.delta;
+    updateAnimation(TICK_TIME);
+}
+
+void updateAnimation(double delta) {
+    game.graphics.animStateTime += delta;
     TextureRegion *keyframe = getAnimationKeyFrame(game.assets->animations[game.graphics.animIndex], game.graphics.animStateTime);
-    if (keyframe != NULL) {
+    if (keyframe != NULL && keyframe != game.graphics.sprite->keyframe) {
         game.graphics.sprite->keyframe = keyframe;
+        game.update.changed = true;
+    }
+    if (updateEntities(game.graphics.entities, (float) delta) > 0) {
+        game.update.changed = true;
+    }
+}
+
+void updateMap() {
+    // Swap in a map finished by the loader, at the frame boundary so the whole frame sees one map
+    map_t *loadedMap = takeLoadedMap(game.mapLoader);
+    if (loadedMap == NULL) return;
+
+    // The cache owns maps from here on, it never evicts the one just inserted or any that are pinned
+    insertCachedMap(game.mapCache, game.wad->fileName, loadedMap);
+    setCurrentMap(loadedMap);
+}
+
+//
+// Switch to a cached map. The view keeps drawing the map it has until the first list of the new one,
+// every map switched to stays pinned in the cache until lists can't draw it anymore.
+//
+void setCurrentMap(map_t *map) {
+    game.map = map;
+    pinCachedMap(game.mapCache, map);
+    if (game.numSwitchedMaps == game.maxSwitchedMaps) {
+        game.maxSwitchedMaps = MAX(2 * game.maxSwitchedMaps, 4);
+        game.switchedMaps = (const map_t **) realloc(game.switchedMaps, game.maxSwitchedMaps * sizeof(map_t *));
+    }
+    game.switchedMaps[game.numSwitchedMaps++] = map;
+    game.mapSwitches++;
+
+    if (game.screen.window != NULL) {
+        char title[64];
+        SDL_snprintf(title, sizeof(title), "%s - %.8s", game.screen.title, game.map->label.name);
+        SDL_SetWindowTitle(game.screen.window, title);
+    }
+
+    // The update thread centers the view on it and spawns its creatures
+    InputEvent input = { .type = INPUT_SET_MAP };
+    input.u.map.map = map;
+    input.u.map.mapSwitch = game.mapSwitches;
+    getRendererSize(game.screen.renderer, &input.u.map.viewWidth, &input.u.map.viewHeight);
+    queueInput(&input);
+
+    const short *box = map->bounds.box;
+    LOG_DEBUG("min (%d, %d)  max(%d, %d)", box[BOXLEFT], box[BOXBOTTOM], box[BOXRIGHT], box[BOXTOP]);
+}
+
+//
+// Draw the map of a switch from here on. Lists come in order, so none still to be drawn
+// can point at the maps of the switches before it, and those are unpinned.
+//
+void showSwitchedMap(unsigned long mapSwitch) {
+    const int index = (int) (mapSwitch - game.shownMapSwitch - 1);
+    assert(index >= 0 && index < game.numSwitchedMaps);
+
+    const map_t *shownMap = game.mapView->map;
+    if (game.switchedMaps[index] != shownMap) {
+        setMapViewMap(game.mapView, game.switchedMaps[index]);
+    }
+    if (shownMap != NULL) {
+        unpinCachedMap(game.mapCache, shownMap);
+    }
+    for (int i = 0; i < index; ++i) {
+        unpinCachedMap(game.mapCache, game.switchedMaps[i]);
+    }
+    game.numSwitchedMaps -= index + 1;
+    SDL_memmove(game.switchedMaps, game.switchedMaps + index + 1, game.numSwitchedMaps * sizeof(map_t *));
+    game.shownMapSwitch = mapSwitch;
+}
+
+//
+// Every thing in the map becomes a creature, animated by its type so things of a type look alike
+//
+void spawnMapCreatures(const map_t *map) {
+    EntityStore *store = game.graphics.entities;
+    clearEntities(store);
+
+    for (int i = 0; i < map->numThings; ++i) {
+        const mapthing_t *thing = &map->things[i];
+        const int animation = (unsigned short) thing->type % store->numAnimations;
+        // Neighbours start a frame apart rather than animating in step
+        const Animation *anim = store->animations[animation];
+        const float stateTime = anim->frameDuration * (float) (i % MAX((int) anim->numKeyFrames, 1));
+
+        const int index = getEntityIndex(store, createEntity(store, map->thingX[i], map->thingY[i], animation, stateTime));
+        if (index < 0) {
+            LOG_WARN("No room for more than %d creatures", store->count);
+            break;
+        }
+        // Doom angles are degrees anticlockwise from east
+        store->facing[index] = (thing->angle > 90 && thing->angle < 270) ? LEFT : RIGHT;
     }
 }
 
 void updateTimer() {
     game.timer.prev = game.timer.now;
-    game.timer.now = SDL_GetPerformanceCounter();
-    game.timer.delta = (double) ((game.timer.now - game.timer.prev) * 1000 / SDL_GetPerformanceFrequency()) * 0.001;
+    game.timer.now = getMicroseconds();
+    game.timer.delta = MIN((double) (game.timer.now - game.timer.prev) * 0.000001, MAX_FRAME_TIME);
 }
 
-void render() {
-    SDL_SetRenderDrawColor(game.screen.renderer, 0xd3, 0xd3, 0xd3, 0x00);
-    SDL_RenderClear(game.screen.renderer);
+//
+// Publish what to draw for the simulation as it is now, from the update thread
+// or the main one when benchmarking
+//
+void publishRenderCommands() {
+    RenderCommandList *list = beginCommandList(game.update.commands);
+    buildRenderCommands(list);
+    list->time = game.timer.now;
+    list->ticks = game.timer.ticks;
+    list->alpha = game.timer.accumulator / TICK_TIME;
+    list->moving = isSceneMoving();
+    list->changed = game.update.changed || list->moving;
+    game.update.changed = false;
+    publishCommandList(game.update.commands);
 
-    renderSprite(game.screen.renderer, game.graphics.sprite);
+    if (game.update.frameEvent != 0) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = game.update.frameEvent;
+        SDL_PushEvent(&event);
+    }
+}
 
-    if (game.map != NULL) {
-        // Draw linedefs
-        SDL_SetRenderDrawColor(game.screen.renderer, 0xFF, 0x00, 0x00, 0xFF);
-        for (int i = 0; i < game.map->numLinedefs; ++i) {
-            int x1 = game.map->vertices[game.map->linedefs[i].v1].x / mapScale - game.view.camera.x;
-            int y1 = game.map->vertices[game.map->linedefs[i].v1].y / mapScale - game.view.camera.y;
-            int x2 = game.map->vertices[game.map->linedefs[i].v2].x / mapScale - game.view.camera.x;
-            int y2 = game.map->vertices[game.map->linedefs[i].v2].y / mapScale - game.view.camera.y;
-            SDL_RenderDrawLine(game.screen.renderer, x1, y1, x2, y2);
+void buildRenderCommands(RenderCommandList *list) {
+    RenderCommand *command = pushRenderCommand(list, RENDER_CLEAR);
+    command->color = (SDL_Color) { 0xd3, 0xd3, 0xd3, 0x00 };
+
+    const Sprite *sprite = game.graphics.sprite;
+    command = pushRenderCommand(list, RENDER_SPRITE);
+    command->u.sprite.region = sprite->keyframe;
+    command->u.sprite.dest = sprite->bounds;
+    command->u.sprite.prevAngle = game.graphics.prevSpriteAngle;
+    command->u.sprite.angle = sprite->angle;
+    command->u.sprite.flip = getSpriteFlip(sprite);
+
+    command = pushRenderCommand(list, RENDER_MAP);
+    command->u.map.map = game.view.map;
+    command->u.map.mapSwitch = game.view.mapSwitch;
+    command->u.map.prevCamera = game.view.prevCamera;
+    command->u.map.camera = game.view.camera;
+
+    command = pushRenderCommand(list, RENDER_ENTITIES);
+    command->u.entities.prevCamera = game.view.prevCamera;
+    command->u.entities.camera = game.view.camera;
+    copyRenderEntities(list, game.graphics.entities);
+}
+
+//
+// Draw a command list alpha of the way from its previous tick to its current one.
+// Runs sprites into the batch, anything else ends the batch first to keep the order.
+//
+void render(const RenderCommandList *list, double alpha) {
+    Renderer *renderer = game.screen.renderer;
+    SpriteBatch *batch = game.graphics.spriteBatch;
+
+    for (int i = 0; i < list->numCommands; ++i) {
+        const RenderCommand *command = &list->commands[i];
+        const SDL_Color color = command->color;
+
+        if (command->type == RENDER_SPRITE) {
+            if (!batch->drawing) {
+                beginSpriteBatch(batch);
+            }
+            const double prevAngle = command->u.sprite.prevAngle;
+            submitTextureRegion(batch, command->u.sprite.region, &command->u.sprite.dest,
+                                prevAngle + (command->u.sprite.angle - prevAngle) * alpha, command->u.sprite.flip);
+            continue;
         }
-        SDL_SetRenderDrawColor(game.screen.renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-        // Draw things
-        SDL_Rect rect;
-        for (int i = 0; i < game.map->numThings; ++i) {
-            const int size = 6;
-            rect = (SDL_Rect) {
-                    .x = (game.map->things[i].x / mapScale) - (size / 2) - game.view.camera.x,
-                    .y = (game.map->things[i].y / mapScale) - (size / 2) - game.view.camera.y,
-                    .w = size, .h = size
-            };
-            SDL_SetRenderDrawColor(game.screen.renderer, 0xFF, 0xFF, 0x00, 0xFF);
-            SDL_RenderFillRect(game.screen.renderer, &rect);
-            SDL_SetRenderDrawColor(game.screen.renderer, 0x00, 0xFF, 0x00, 0xFF);
-            SDL_RenderDrawRect(game.screen.renderer, &rect);
+        if (command->type == RENDER_ENTITIES) {
+            if (!batch->drawing) {
+                beginSpriteBatch(batch);
+            }
+            const Camera camera = lerpCamera(&command->u.entities.prevCamera, &command->u.entities.camera, alpha);
+            submitEntities(&list->entities, &camera);
+            continue;
         }
-        SDL_SetRenderDrawColor(game.screen.renderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-        // Draw map bounds rect
-        rect = (SDL_Rect) {
-                .x = (mapMinX / mapScale) - game.view.camera.x,
-                .y = (mapMinY / mapScale) - game.view.camera.y,
-                .w = (mapMaxX - mapMinX) / mapScale,
-                .h = (mapMaxY - mapMinY) / mapScale
-        };
-        SDL_SetRenderDrawColor(game.screen.renderer, 0x00, 0x00, 0xFF, 0xFF);
-        SDL_RenderDrawRect(game.screen.renderer, &rect);
-
-        // Draw map bounds rect min x,y
-        const int size = 10;
-        rect = (SDL_Rect) {
-                .x = (mapMinX / mapScale) - (size / 2) - game.view.camera.x,
-                .y = (mapMinY / mapScale) - (size / 2) - game.view.camera.y,
-                .w = size, .h = size
-        };
-        SDL_SetRenderDrawColor(game.screen.renderer, 0x00, 0x00, 0xFF, 0xFF);
-        SDL_RenderFillRect(game.screen.renderer, &rect);
-
-        // Draw map bounds rect center
-        rect = (SDL_Rect) {
-                .x = rect.x + (((mapMaxX - mapMinX) / mapScale) / 2),
-                .y = rect.y + (((mapMaxY - mapMinY) / mapScale) / 2),
-                .w = size, .h = size
+        if (batch->drawing) {
+            endSpriteBatch(batch);
+        }
+
+        switch (command->type) {
+            case RENDER_CLEAR: {
+                setRenderColor(renderer, color.r, color.g, color.b, color.a);
+                renderClear(renderer);
+            } break;
+            case RENDER_MAP: {
+                // The first list of a map switched to, together with its creatures
+                if (command->u.map.mapSwitch > game.shownMapSwitch) {
+                    showSwitchedMap(command->u.map.mapSwitch);
+                }
+                if (command->u.map.map == NULL) break;
+                const Camera camera = lerpCamera(&command->u.map.prevCamera, &command->u.map.camera, alpha);
+                renderMapView(game.mapView, &camera);
+            } break;
+            default: break;
+        }
+    }
+    if (batch->drawing) {
+        endSpriteBatch(batch);
+    }
+
+    renderPresent(renderer);
+}
+
+//
+// Submit the entities in view to the batch, their screen positions transformed all at once
+//
+void submitEntities(const RenderEntities *entities, const Camera *camera) {
+    SpriteBatch *batch = game.graphics.spriteBatch;
+    const int count = entities->count;
+    if (count > game.graphics.maxEntityPositions) {
+        game.graphics.maxEntityPositions = MAX(count, 2 * game.graphics.maxEntityPositions);
+        game.graphics.entityScreenX = (float *) realloc(game.graphics.entityScreenX, game.graphics.maxEntityPositions * sizeof(float));
+        game.graphics.entityScreenY = (float *) realloc(game.graphics.entityScreenY, game.graphics.maxEntityPositions * sizeof(float));
+    }
+    float *screenX = game.graphics.entityScreenX;
+    float *screenY = game.graphics.entityScreenY;
+    worldToScreen(camera, entities->x, entities->y, count, screenX, screenY);
+
+    int width, height;
+    getRendererSize(game.screen.renderer, &width, &height);
+    const float scale = MAX(ENTITY_TEXEL_SIZE * camera->zoom, ENTITY_MIN_SCALE);
+    for (int i = 0; i < count; ++i) {
+        const TextureRegion *keyframe = entities->keyframe[i];
+        const int w = (int) ((float) keyframe->sourceW * scale + 0.5f);
+        const int h = (int) ((float) keyframe->sourceH * scale + 0.5f);
+        const SDL_Rect dest = {
+                .x = (int) SDL_floor(screenX[i] - 0.5f * (float) w + 0.5f),
+                .y = (int) SDL_floor(screenY[i] - 0.5f * (float) h + 0.5f),
+                .w = w, .h = h
         };
-        SDL_SetRenderDrawColor(game.screen.renderer, 0xAA, 0x00, 0xAA, 0xFF);
-        SDL_RenderFillRect(game.screen.renderer, &rect);
+        if (dest.x >= width || dest.y >= height || dest.x + dest.w <= 0 || dest.y + dest.h <= 0) continue;
 
-        SDL_SetRenderDrawColor(game.screen.renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+        submitTextureRegion(batch, keyframe, &dest, entities->angle[i], getFacingFlip((enum Facing) entities->facing[i]));
     }
+}
 
-    SDL_RenderPresent(game.screen.renderer);
+//
+// Render the scripted camera path over a map offscreen, then report frame times and draw counts.
+// Maps load on this thread, only rendering is timed.
+//
+void runBench() {
+    Bench *bench = game.bench.bench;
+    const char *mapName = bench->options.mapName;
+
+    const wadmap_t *wadmap = NULL;
+    for (int i = 0; i < game.maplumps.count && wadmap == NULL; ++i) {
+        if (mapName == NULL || SDL_strcasecmp(game.maplumps.maps[i].name, mapName) == 0) {
+            wadmap = &game.maplumps.maps[i];
+        }
+    }
+    if (wadmap == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "No map '%s' in WAD '%s'",
+                     (mapName != NULL) ? mapName : "", game.paths.wad);
+        exit(1);
+    }
+
+    map_t *map = loadWadMap(game.wad, wadmap);
+    insertCachedMap(game.mapCache, game.wad->fileName, map);
+    setCurrentMap(map);
+
+    for (int frame = 0; frame < bench->options.frames; ++frame) {
+        applyQueuedInput();
+        getBenchCamera(bench, game.map->bounds.box, frame, &game.view.camera);
+        updateAnimation(BENCH_FRAME_TIME);
+        publishRenderCommands();
+        const RenderCommandList *list = acquireCommandList(game.update.commands);
+
+        const uint64_t start = getMicroseconds();
+        render(list, 1.0);
+        recordBenchFrame(bench, getMicroseconds() - start, game.screen.renderer);
+
+        dumpBenchFrame(bench, game.screen.renderer, frame);
+        flushLog();
+    }
+
+    reportBench(bench, wadmap->name, stdout);
 }
 
 void shutdown() {
-    SDL_DestroyRenderer(game.screen.renderer);
+    stopUpdateThread();
+
+    // The map view's tile textures go with the renderer
+    destroyMapView(game.mapView);
+    destroySpriteBatch(game.graphics.spriteBatch);
+    free(game.graphics.entityScreenX);
+    free(game.graphics.entityScreenY);
+    free(game.switchedMaps);
+    destroyRenderer(game.screen.renderer);
     SDL_DestroyWindow(game.screen.window);
+    destroyBench(game.bench.bench);
 
+    destroyEntityStore(game.graphics.entities);
     destroyAssets(game.assets);
-    freeMap(game.map);
-    freeMapLumps(game.maplumps);
+    destroyMapLoader(game.mapLoader);
+    destroyMapCache(game.mapCache);
+    closeWad(game.wad);
+    destroyCommandBuffer(game.update.commands);
+    SDL_DestroyCond(game.update.wake);
+    SDL_DestroyMutex(game.update.lock);
     if (msgBoxButtons != NULL) {
         free(msgBoxButtons);
         msgBoxButtons = NULL;
     }
 
+    flushLog();
     SDL_Quit();
     game.running = false;
 }
 
 int main(int argc, char **argv) {
+    parseArgs(argc, argv);
     init();
+    if (game.bench.enabled) {
+        runBench();
+        exit(0);
+    }
+
     while (game.running) {
         events();
-        update();
-        render();
+        runFrame();
+        flushLog();
     }
     exit(0);
 }
@@ -352,12 +1141,12 @@ void showMapSelectDialog() {
         free(msgBoxButtons);
         msgBoxButtons = NULL;
     }
-    msgBoxButtons = (SDL_MessageBoxButtonData *) calloc((size_t) game.maplumps->count, sizeof(SDL_MessageBoxButtonData));
-    for (int i = 0; i < game.maplumps->count; ++i) {
+    msgBoxButtons = (SDL_MessageBoxButtonData *) calloc((size_t) game.maplumps.count, sizeof(SDL_MessageBoxButtonData));
+    for (int i = 0; i < game.maplumps.count; ++i) {
         msgBoxButtons[i] = (SDL_MessageBoxButtonData) {
                 .flags = 0,
                 .buttonid = i,
-                .text = game.maplumps->lumps[i].name
+                .text = game.maplumps.maps[i].name
         };
     }
 
@@ -366,38 +1155,28 @@ void showMapSelectDialog() {
             .window = game.screen.window,
             .title = "Map Picker",
             .message = "Pick a map to view",
-            .numbuttons = game.maplumps->count,
+            .numbuttons = game.maplumps.count,
             .buttons = msgBoxButtons,
             .colorScheme = NULL
     };
     if (SDL_ShowMessageBox(&messageBoxData, &game.currentMap) == 0) {
-        printf("\nMap lump selected: %d - %.*s",
-               game.currentMap, 8, game.maplumps->lumps[game.currentMap].name);
+        LOG_INFO("Map lump selected: %d - %s", game.currentMap, game.maplumps.maps[game.currentMap].name);
 
-        if (game.map != NULL) {
-            freeMap(game.map);
-        }
+        const wadmap_t *wadmap = &game.maplumps.maps[game.currentMap];
 
-        game.map = (map_t *) calloc(1, sizeof(map_t));
-        loadWadMap("data/doom1.wad", &game.maplumps->lumps[game.currentMap], game.map);
-
-        // Determine map bounds and shift camera so map is in view
-        mapMinX = INT32_MAX;
-        mapMinY = INT32_MAX;
-        mapMaxX = INT32_MIN;
-        mapMaxY = INT32_MIN;
-        for (int i = 0; i < game.map->numVertexes; ++i) {
-            if (game.map->vertices[i].x < mapMinX) mapMinX = game.map->vertices[i].x;
-            if (game.map->vertices[i].y < mapMinY) mapMinY = game.map->vertices[i].y;
-            if (game.map->vertices[i].x > mapMaxX) mapMaxX = game.map->vertices[i].x;
-            if (game.map->vertices[i].y > mapMaxY) mapMaxY = game.map->vertices[i].y;
+        // Recently viewed maps are swapped in straight from the cache
+        map_t *cachedMap = findCachedMap(game.mapCache, game.wad->fileName, wadmap->name);
+        if (cachedMap != NULL) {
+            cancelMapLoad(game.mapLoader);
+            setCurrentMap(cachedMap);
+            return;
         }
 
-        int minx = (mapMinX / mapScale) + (SCREEN_WIDTH  / 2) - (((mapMaxX - mapMinX) / mapScale) / 2);
-        int miny = (mapMinY / mapScale) + (SCREEN_HEIGHT / 2) - (((mapMaxY - mapMinY) / mapScale) / 2);
-        game.view.camera.x = minx;
-        game.view.camera.y = miny;
+        // Keep rendering the current map until the new one is swapped in by updateMap()
+        requestMapLoad(game.mapLoader, wadmap);
 
-        printf("min (%d, %d)  max(%d, %d)\n", mapMinX, mapMinY, mapMaxX, mapMaxY);
+        char title[64];
+        SDL_snprintf(title, sizeof(title), "%s - loading %s...", game.screen.title, wadmap->name);
+        SDL_SetWindowTitle(game.screen.window, title);
     }
 }
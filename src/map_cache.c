@@ -0,0 +1,134 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "map_cache.h"
+#include "log.h"
+
+static void unlinkEntry(MapCache *cache, MapCacheEntry *entry) {
+    if (entry->prev != NULL) entry->prev->next = entry->next;
+    else                     cache->head       = entry->next;
+    if (entry->next != NULL) entry->next->prev = entry->prev;
+    else                     cache->tail       = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+static void pushFrontEntry(MapCache *cache, MapCacheEntry *entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL) cache->head->prev = entry;
+    cache->head = entry;
+    if (cache->tail == NULL) cache->tail = entry;
+}
+
+//
+// Evict least recently used maps until the cache is within budget, sparing the most recent and pinned ones
+//
+static void evictMaps(MapCache *cache) {
+    MapCacheEntry *next = cache->tail;
+    while (cache->usedBytes > cache->budgetBytes && next != NULL && next != cache->head) {
+        MapCacheEntry *entry = next;
+        next = entry->prev;
+        if (entry->pins > 0) continue;
+        unlinkEntry(cache, entry);
+
+        LOG_DEBUG("Evicting cached map %.8s from %s, %lu bytes",
+                  entry->map->label.name, entry->wadFileName, (unsigned long) entry->map->arenaSize);
+        cache->usedBytes -= entry->map->arenaSize;
+        cache->numEntries--;
+        cache->evictions++;
+        freeMap(entry->map);
+        free(entry);
+    }
+}
+
+MapCache *createMapCache(size_t budgetBytes) {
+    MapCache *cache = (MapCache *) calloc(1, sizeof(MapCache));
+    cache->budgetBytes = budgetBytes;
+    return cache;
+}
+
+//
+// Get the cached map for the label in the WAD and mark it most recently used, or NULL on a miss
+//
+map_t *findCachedMap(MapCache *cache, const char *wadFileName, const char *label) {
+    assert(cache != NULL && wadFileName != NULL && label != NULL);
+
+    const uint64_t labelKey = getLumpKey(label);
+    for (MapCacheEntry *entry = cache->head; entry != NULL; entry = entry->next) {
+        if (entry->labelKey == labelKey && strcmp(entry->wadFileName, wadFileName) == 0) {
+            unlinkEntry(cache, entry);
+            pushFrontEntry(cache, entry);
+            cache->hits++;
+            return entry->map;
+        }
+    }
+
+    cache->misses++;
+    return NULL;
+}
+
+//
+// Take ownership of a freshly loaded map as the most recently used entry,
+// evicting older maps to stay within budget
+//
+void insertCachedMap(MapCache *cache, const char *wadFileName, map_t *map) {
+    assert(cache != NULL && wadFileName != NULL && map != NULL);
+
+    MapCacheEntry *entry = (MapCacheEntry *) calloc(1, sizeof(MapCacheEntry));
+    entry->wadFileName = wadFileName;
+    entry->labelKey = getLumpKey(map->label.name);
+    entry->map = map;
+
+    pushFrontEntry(cache, entry);
+    cache->usedBytes += map->arenaSize;
+    cache->numEntries++;
+
+    evictMaps(cache);
+}
+
+static MapCacheEntry *findMapEntry(MapCache *cache, const map_t *map) {
+    for (MapCacheEntry *entry = cache->head; entry != NULL; entry = entry->next) {
+        if (entry->map == map) return entry;
+    }
+    return NULL;
+}
+
+//
+// Keep a cached map from being evicted until it's unpinned as many times as it was pinned
+//
+void pinCachedMap(MapCache *cache, const map_t *map) {
+    assert(cache != NULL && map != NULL);
+
+    MapCacheEntry *entry = findMapEntry(cache, map);
+    assert(entry != NULL);
+    entry->pins++;
+}
+
+void unpinCachedMap(MapCache *cache, const map_t *map) {
+    assert(cache != NULL && map != NULL);
+
+    MapCacheEntry *entry = findMapEntry(cache, map);
+    assert(entry != NULL && entry->pins > 0);
+    entry->pins--;
+    evictMaps(cache);
+}
+
+void setMapCacheBudget(MapCache *cache, size_t budgetBytes) {
+    assert(cache != NULL);
+    cache->budgetBytes = budgetBytes;
+    evictMaps(cache);
+}
+
+void destroyMapCache(MapCache *cache) {
+    if (cache == NULL) return;
+
+    MapCacheEntry *entry = cache->head;
+    while (entry != NULL) {
+        MapCacheEntry *next = entry->next;
+        freeMap(entry->map);
+        free(entry);
+        entry = next;
+    }
+    free(cache);
+}
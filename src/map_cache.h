@@ -0,0 +1,41 @@
+#ifndef SERAPH_MAP_CACHE_H
+#define SERAPH_MAP_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "doom/doom_utils.h"
+
+typedef struct MapCacheEntry {
+    const char *wadFileName;
+    uint64_t labelKey;
+    map_t *map;
+    int pins; // never evicted while pinned
+    struct MapCacheEntry *prev;
+    struct MapCacheEntry *next;
+} MapCacheEntry;
+
+// Memory bounded, least recently used cache of parsed maps keyed by WAD and map label.
+// The cache owns its maps. The most recently used one and any that are pinned are never evicted,
+// so they're safe to display.
+typedef struct MapCache {
+    size_t budgetBytes;
+    size_t usedBytes;
+    size_t numEntries;
+    MapCacheEntry *head; // most recently used
+    MapCacheEntry *tail; // least recently used
+    // Counters
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long evictions;
+} MapCache;
+
+MapCache *createMapCache(size_t budgetBytes);
+map_t *findCachedMap(MapCache *cache, const char *wadFileName, const char *label);
+void insertCachedMap(MapCache *cache, const char *wadFileName, map_t *map);
+void pinCachedMap(MapCache *cache, const map_t *map);
+void unpinCachedMap(MapCache *cache, const map_t *map);
+void setMapCacheBudget(MapCache *cache, size_t budgetBytes);
+void destroyMapCache(MapCache *cache);
+
+#endif //SERAPH_MAP_CACHE_H
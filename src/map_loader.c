@@ -0,0 +1,138 @@
+#include <assert.h>
+
+#include "map_loader.h"
+#include "log.h"
+
+static int runMapLoader(void *data);
+
+MapLoader *createMapLoader(const wad_t *wad) {
+    assert(wad != NULL);
+
+    MapLoader *loader = (MapLoader *) calloc(1, sizeof(MapLoader));
+    loader->wad = wad;
+    loader->lock = SDL_CreateMutex();
+    loader->wake = SDL_CreateCond();
+    SDL_AtomicSet(&loader->state, MAP_LOAD_IDLE);
+
+    loader->thread = SDL_CreateThread(runMapLoader, "MapLoader", loader);
+    if (loader->lock == NULL || loader->wake == NULL || loader->thread == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create map loader thread: %s", SDL_GetError());
+        exit(1);
+    }
+    return loader;
+}
+
+//
+// Queue a map to load, replacing any request the worker hasn't picked up yet
+//
+void requestMapLoad(MapLoader *loader, const wadmap_t *wadmap) {
+    assert(loader != NULL && wadmap != NULL);
+
+    SDL_LockMutex(loader->lock);
+    {
+        loader->request = wadmap;
+        ++loader->generation;
+        SDL_AtomicSet(&loader->state, MAP_LOAD_QUEUED);
+        SDL_CondSignal(loader->wake);
+    }
+    SDL_UnlockMutex(loader->lock);
+}
+
+//
+// Drop any queued request and discard the result of any load in progress
+//
+void cancelMapLoad(MapLoader *loader) {
+    assert(loader != NULL);
+
+    SDL_LockMutex(loader->lock);
+    {
+        loader->request = NULL;
+        ++loader->generation;
+        freeMap(loader->staging);
+        loader->staging = NULL;
+        SDL_AtomicSet(&loader->state, MAP_LOAD_IDLE);
+    }
+    SDL_UnlockMutex(loader->lock);
+}
+
+enum MapLoadState getMapLoadState(MapLoader *loader) {
+    assert(loader != NULL);
+    return (enum MapLoadState) SDL_AtomicGet(&loader->state);
+}
+
+//
+// Take ownership of the most recently loaded map, or NULL if none is ready.
+// Cheap enough to poll every frame, it only locks once a map is ready.
+//
+map_t *takeLoadedMap(MapLoader *loader) {
+    assert(loader != NULL);
+
+    if (SDL_AtomicGet(&loader->state) != MAP_LOAD_READY) {
+        return NULL;
+    }
+
+    map_t *map = NULL;
+    SDL_LockMutex(loader->lock);
+    {
+        // A newer request may have been queued since the check, leave it to supersede this one
+        if (SDL_AtomicGet(&loader->state) == MAP_LOAD_READY) {
+            map = loader->staging;
+            loader->staging = NULL;
+            SDL_AtomicSet(&loader->state, MAP_LOAD_IDLE);
+        }
+    }
+    SDL_UnlockMutex(loader->lock);
+    return map;
+}
+
+void destroyMapLoader(MapLoader *loader) {
+    if (loader == NULL) return;
+
+    SDL_LockMutex(loader->lock);
+    {
+        loader->quit = true;
+        SDL_CondSignal(loader->wake);
+    }
+    SDL_UnlockMutex(loader->lock);
+    SDL_WaitThread(loader->thread, NULL);
+
+    freeMap(loader->staging);
+    SDL_DestroyCond(loader->wake);
+    SDL_DestroyMutex(loader->lock);
+    free(loader);
+}
+
+static int runMapLoader(void *data) {
+    MapLoader *loader = (MapLoader *) data;
+
+    SDL_LockMutex(loader->lock);
+    while (!loader->quit) {
+        if (loader->request == NULL) {
+            SDL_CondWait(loader->wake, loader->lock);
+            continue;
+        }
+
+        const wadmap_t *wadmap = loader->request;
+        const unsigned int generation = loader->generation;
+        loader->request = NULL;
+        SDL_AtomicSet(&loader->state, MAP_LOAD_LOADING);
+        SDL_UnlockMutex(loader->lock);
+
+        map_t *map = loadWadMap(loader->wad, wadmap);
+
+        SDL_LockMutex(loader->lock);
+        if (loader->generation != generation) {
+            // Superseded or cancelled while loading, any newer request is picked up next
+            LOG_DEBUG("Discarding map %s, no longer requested", wadmap->name);
+            freeMap(map);
+            continue;
+        }
+
+        // Replace any map that was staged but never taken
+        freeMap(loader->staging);
+        loader->staging = map;
+        SDL_AtomicSet(&loader->state, MAP_LOAD_READY);
+    }
+    SDL_UnlockMutex(loader->lock);
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SERAPH_MAP_LOADER_H
+#define SERAPH_MAP_LOADER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+#include "doom/doom_utils.h"
+
+enum MapLoadState { MAP_LOAD_IDLE, MAP_LOAD_QUEUED, MAP_LOAD_LOADING, MAP_LOAD_READY };
+
+// Loads maps on a worker thread into a staging map, which the main thread
+// takes ownership of at a frame boundary while the current map keeps rendering
+typedef struct MapLoader {
+    const wad_t *wad;
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    SDL_atomic_t state;
+    // Guarded by lock
+    bool quit;
+    unsigned int generation; // bumped by every request and cancel
+    const wadmap_t *request;
+    map_t *staging;
+} MapLoader;
+
+MapLoader *createMapLoader(const wad_t *wad);
+void requestMapLoad(MapLoader *loader, const wadmap_t *wadmap);
+void cancelMapLoad(MapLoader *loader);
+enum MapLoadState getMapLoadState(MapLoader *loader);
+map_t *takeLoadedMap(MapLoader *loader);
+void destroyMapLoader(MapLoader *loader);
+
+#endif //SERAPH_MAP_LOADER_H
@@ -0,0 +1,536 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "map_view.h"
+#include "common.h"
+#include "log.h"
+
+static const SDL_Color linedefClassColors[NUM_LINEDEF_CLASSES] = {
+        { 0xA0, 0x60, 0x60, 0xFF }, // two sided
+        { 0xFF, 0x00, 0x00, 0xFF }, // one sided
+        { 0xFF, 0xA0, 0x00, 0xFF }, // special
+        { 0xFF, 0x00, 0xFF, 0xFF }, // secret
+        { 0x00, 0x00, 0x00, 0x00 }, // hidden, never drawn
+};
+
+static const SDL_Color thingClassColors[NUM_THING_CLASSES] = {
+        { 0x80, 0x80, 0x80, 0xFF }, // other
+        { 0x00, 0xFF, 0xFF, 0xFF }, // player
+        { 0xFF, 0x40, 0x40, 0xFF }, // monster
+        { 0xFF, 0xFF, 0x00, 0xFF }, // weapon
+        { 0xC0, 0xC0, 0x00, 0xFF }, // ammo
+        { 0x40, 0x80, 0xFF, 0xFF }, // pickup
+        { 0xFF, 0xFF, 0xFF, 0xFF }, // key
+};
+
+#define THING_MARKER_SIZE 6
+
+static void freeMapViewBuffers(MapView *view) {
+    freeAligned(view->points);
+    free(view->nodeStack);
+    free(view->subsectors);
+    free(view->found);
+    free(view->batch);
+    free(view->batchPoints);
+#if MAP_VIEW_GEOMETRY
+    free(view->batchVertices);
+    free(view->batchIndices);
+#endif
+    free(view->thingRects);
+}
+
+MapView *createMapView(Renderer *renderer) {
+    assert(renderer != NULL);
+    // Every LOD level has to be reachable by zooming out
+    assert((float) (MAP_LOD_MIN_SCALE << (MAP_LOD_LEVELS - 1)) <= 1.f / CAMERA_MIN_ZOOM);
+
+    MapView *view = (MapView *) calloc(1, sizeof(MapView));
+    view->renderer = renderer;
+    view->useTiles = renderTargetSupported(renderer);
+    if (!view->useTiles) {
+        LOG_WARN("Renderer can't render to textures, drawing map lines directly");
+    }
+    return view;
+}
+
+//
+// Switch the view to another map, or to none with NULL.
+// The map comes classified and simplified by its loader, the view only grows its buffers if the map needs more room.
+//
+void setMapViewMap(MapView *view, const map_t *map) {
+    assert(view != NULL);
+
+    invalidateMapViewTiles(view);
+    view->map = map;
+    view->dirty = true;
+    view->linesDirty = true;
+    if (map == NULL) return;
+
+    // Screen space positions, aligned for the transform kernel
+    if (map->numVertexes > view->vertexCapacity || map->numThings > view->thingCapacity || view->points == NULL) {
+        view->vertexCapacity = MAX(view->vertexCapacity, map->numVertexes);
+        view->thingCapacity = MAX(view->thingCapacity, map->numThings);
+        freeAligned(view->points);
+        const size_t numPoints = 2 * (size_t) view->vertexCapacity + 2 * (size_t) view->thingCapacity;
+        view->points = (float *) allocAligned(64, MAX(numPoints, 1) * sizeof(float));
+        free(view->thingRects);
+        view->thingRects = (SDL_FRect *) calloc(MAX(view->thingCapacity, 1), sizeof(SDL_FRect));
+    }
+    view->vertexX = view->points;
+    view->vertexY = view->points + view->vertexCapacity;
+    view->thingX  = view->points + 2 * view->vertexCapacity;
+    view->thingY  = view->points + 2 * view->vertexCapacity + view->thingCapacity;
+
+    if (MAX(map->numNodes, 1) > view->nodeCapacity) {
+        view->nodeCapacity = MAX(map->numNodes, 1);
+        free(view->nodeStack);
+        view->nodeStack = (int *) calloc(view->nodeCapacity, sizeof(int));
+    }
+    if (MAX(map->numSubsectors, 1) > view->subsectorCapacity) {
+        view->subsectorCapacity = MAX(map->numSubsectors, 1);
+        free(view->subsectors);
+        view->subsectors = (int *) calloc(view->subsectorCapacity, sizeof(int));
+    }
+
+    // At most one line per seg with a BSP, or per linedef without
+    const int maxLines = MAX(MAX(map->numSegs, map->numLinedefs), 1);
+    if (maxLines > view->lineCapacity) {
+        view->lineCapacity = maxLines;
+        free(view->found);
+        free(view->batch);
+        free(view->batchPoints);
+        view->found = (mapline_t *) calloc(view->lineCapacity, sizeof(mapline_t));
+        view->batch = (mapline_t *) calloc(view->lineCapacity, sizeof(mapline_t));
+        view->batchPoints = (SDL_FPoint *) calloc(2 * (size_t) view->lineCapacity, sizeof(SDL_FPoint));
+
+#if MAP_VIEW_GEOMETRY
+        // A quad of two triangles per line, the indices are the same whichever lines are batched
+        free(view->batchVertices);
+        free(view->batchIndices);
+        view->batchVertices = (SDL_Vertex *) calloc(4 * (size_t) view->lineCapacity, sizeof(SDL_Vertex));
+        view->batchIndices = (int *) calloc(6 * (size_t) view->lineCapacity, sizeof(int));
+        for (int i = 0; i < view->lineCapacity; ++i) {
+            int *indices = &view->batchIndices[6 * i];
+            indices[0] = 4 * i;     indices[1] = 4 * i + 1; indices[2] = 4 * i + 2;
+            indices[3] = 4 * i + 2; indices[4] = 4 * i + 1; indices[5] = 4 * i + 3;
+        }
+#endif
+    }
+}
+
+//
+// Scale the things to a zoom, one multiply a point, and place their markers around them,
+// leaving the vertices until lines are drawn directly. Panning never needs this, only zooming.
+//
+static void updateMapViewGeometry(MapView *view, float zoom) {
+    const map_t *map = view->map;
+
+    transformPoints(map->thingX, map->thingY, map->numThings, zoom, 0.f, 0.f, view->thingX, view->thingY);
+    const float half = THING_MARKER_SIZE / 2.f;
+    for (int i = 0; i < map->numThings; ++i) {
+        const int thing = map->thingsByClass[i];
+        view->thingRects[i] = (SDL_FRect) {
+                .x = view->thingX[thing] - half,
+                .y = view->thingY[thing] - half,
+                .w = THING_MARKER_SIZE, .h = THING_MARKER_SIZE
+        };
+    }
+
+    view->zoom = zoom;
+    view->dirty = false;
+    view->verticesDirty = true;
+    view->linesDirty = true;
+    view->transforms++;
+}
+
+//
+// Batch the lines touching a box in map units, sorted by class.
+// Zoomed out the lines come from the simplified level for the map units per pixel. At full detail and with a BSP
+// only the front segs of the subsectors in the box are batched, otherwise whole linedefs.
+//
+static void batchMapLines(MapView *view, const int box[4], float zoom) {
+    const map_t *map = view->map;
+    const unsigned char *classes = map->linedefClasses;
+    const int level = getMapLodLevel(1.f / zoom);
+    view->lodLevel = level;
+
+    int count = 0;
+    if (level >= 0) {
+        for (int i = 0; i < map->numLodLines[level]; ++i) {
+            const short *bbox = map->lodBounds[level][i].box;
+            if (bbox[BOXRIGHT] < box[BOXLEFT] || bbox[BOXLEFT] > box[BOXRIGHT]
+             || bbox[BOXTOP] < box[BOXBOTTOM] || bbox[BOXBOTTOM] > box[BOXTOP]) continue;
+
+            view->found[count++] = map->lodLines[level][i];
+        }
+    } else if (map->numSubsectors > 0) {
+        const int numSubsectors = findMapSubsectors(map, box, view->nodeStack, view->subsectors);
+        for (int i = 0; i < numSubsectors; ++i) {
+            const mapsubsector_t *subsector = &map->subsectors[view->subsectors[i]];
+            const int firstSeg = (unsigned short) subsector->firstSeg;
+            const int lastSeg = firstSeg + (unsigned short) subsector->numSegs;
+            for (int s = firstSeg; s < lastSeg; ++s) {
+                // Two sided lines have a seg on each side, only draw the front
+                const mapseg_t *seg = &map->segs[s];
+                const int linedef = (unsigned short) seg->linedef;
+                if (seg->side != 0 || classes[linedef] == LINEDEF_HIDDEN) continue;
+
+                const short *bbox = map->linedefBounds[linedef].box;
+                if (bbox[BOXRIGHT] < box[BOXLEFT] || bbox[BOXLEFT] > box[BOXRIGHT]
+                 || bbox[BOXTOP] < box[BOXBOTTOM] || bbox[BOXBOTTOM] > box[BOXTOP]) continue;
+
+                view->found[count++] = (mapline_t) { (unsigned short) seg->v1, (unsigned short) seg->v2, linedef };
+            }
+        }
+    } else {
+        for (int i = 0; i < map->numLinedefs; ++i) {
+            if (classes[i] == LINEDEF_HIDDEN) continue;
+
+            const short *bbox = map->linedefBounds[i].box;
+            if (bbox[BOXRIGHT] < box[BOXLEFT] || bbox[BOXLEFT] > box[BOXRIGHT]
+             || bbox[BOXTOP] < box[BOXBOTTOM] || bbox[BOXBOTTOM] > box[BOXTOP]) continue;
+
+            const linedef_t *line = &map->linedefs[i];
+            view->found[count++] = (mapline_t) { (unsigned short) line->v1, (unsigned short) line->v2, i };
+        }
+    }
+
+    // Counting sort into the batch, so lines are drawn in class order
+    int next[NUM_LINEDEF_CLASSES] = { 0 };
+    for (int i = 0; i < count; ++i) {
+        next[classes[view->found[i].linedef]]++;
+    }
+    view->batchClassStart[0] = 0;
+    for (int c = 0; c < NUM_LINEDEF_CLASSES; ++c) {
+        view->batchClassStart[c + 1] = view->batchClassStart[c] + next[c];
+        next[c] = view->batchClassStart[c];
+    }
+    for (int i = 0; i < count; ++i) {
+        view->batch[next[classes[view->found[i].linedef]]++] = view->found[i];
+    }
+}
+
+//
+// Build the quads of the batched lines, positioned at x * scale + offset
+//
+static void buildBatchQuads(MapView *view, const float *x, const float *y, float scale, float offsetX, float offsetY) {
+#if MAP_VIEW_GEOMETRY
+    for (int c = 0; c < LINEDEF_HIDDEN; ++c) {
+        const SDL_Color color = linedefClassColors[c];
+        for (int i = view->batchClassStart[c]; i < view->batchClassStart[c + 1]; ++i) {
+            const mapline_t line = view->batch[i];
+            const float x1 = x[line.v1] * scale + offsetX;
+            const float y1 = y[line.v1] * scale + offsetY;
+            const float x2 = x[line.v2] * scale + offsetX;
+            const float y2 = y[line.v2] * scale + offsetY;
+
+            // Half a pixel either side, simplified lines don't run along their linedef
+            float nx = 0.f, ny = 0.f;
+            const float length = (float) SDL_sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+            if (length > 0.f) {
+                nx = (y1 - y2) / length * 0.5f;
+                ny = (x2 - x1) / length * 0.5f;
+            }
+            SDL_Vertex *vertices = &view->batchVertices[4 * i];
+            vertices[0] = (SDL_Vertex) { { x1 + nx, y1 + ny }, color, { 0.f, 0.f } };
+            vertices[1] = (SDL_Vertex) { { x1 - nx, y1 - ny }, color, { 0.f, 0.f } };
+            vertices[2] = (SDL_Vertex) { { x2 + nx, y2 + ny }, color, { 0.f, 0.f } };
+            vertices[3] = (SDL_Vertex) { { x2 - nx, y2 - ny }, color, { 0.f, 0.f } };
+        }
+    }
+#else
+    (void) view; (void) x; (void) y; (void) scale; (void) offsetX; (void) offsetY;
+#endif
+}
+
+//
+// Draw the batched lines, from their quads in one call when possible,
+// otherwise a line at a time positioned like buildBatchQuads()
+//
+static void drawBatch(MapView *view, const float *x, const float *y, float scale, float offsetX, float offsetY) {
+    Renderer *renderer = view->renderer;
+    const int count = view->batchClassStart[LINEDEF_HIDDEN];
+    view->linesDrawn = count;
+    if (count == 0) return;
+
+#if MAP_VIEW_GEOMETRY
+    if (renderGeometry(renderer, NULL, view->batchVertices, 4 * count, view->batchIndices, 6 * count)) {
+        return;
+    }
+#endif
+
+    SDL_FPoint *points = view->batchPoints;
+    for (int i = 0; i < count; ++i) {
+        const mapline_t line = view->batch[i];
+        points[2 * i]     = (SDL_FPoint) { x[line.v1] * scale + offsetX, y[line.v1] * scale + offsetY };
+        points[2 * i + 1] = (SDL_FPoint) { x[line.v2] * scale + offsetX, y[line.v2] * scale + offsetY };
+    }
+    for (int c = 0; c < LINEDEF_HIDDEN; ++c) {
+        const SDL_Color color = linedefClassColors[c];
+        const int first = view->batchClassStart[c];
+        setRenderColor(renderer, color.r, color.g, color.b, color.a);
+        renderDrawLinesF(renderer, &points[2 * first], view->batchClassStart[c + 1] - first);
+    }
+}
+
+void invalidateMapViewTiles(MapView *view) {
+    assert(view != NULL);
+
+    for (int i = 0; i < MAP_VIEW_MAX_TILES; ++i) {
+        view->tiles[i].valid = false;
+    }
+}
+
+// The zoom of a tile level
+static float getTileZoom(int level) {
+    return (float) SDL_pow(2.0, (double) level / MAP_TILE_LEVELS_PER_DOUBLING);
+}
+
+// The tile level at or below a zoom, allowing for rounding in zooms stepped onto a level
+static int getTileLevel(float zoom) {
+    return (int) SDL_floor(SDL_log(zoom) / SDL_log(2.0) * MAP_TILE_LEVELS_PER_DOUBLING + 0.001);
+}
+
+//
+// Render the lines touching a tile into its texture
+//
+static void renderMapTile(MapView *view, MapTile *tile) {
+    const map_t *map = view->map;
+    Renderer *renderer = view->renderer;
+
+    // The tile's extents in map units, with a pixel of margin for the width of the lines
+    const float zoom = getTileZoom(tile->level);
+    const float originX = (float) (tile->x * MAP_TILE_SIZE);
+    const float originY = (float) (tile->y * MAP_TILE_SIZE);
+    int box[4];
+    box[BOXLEFT]   = (int) SDL_floor((originX - 1.f) / zoom);
+    box[BOXRIGHT]  = (int) SDL_ceil((originX + MAP_TILE_SIZE + 1.f) / zoom);
+    box[BOXBOTTOM] = (int) SDL_floor((originY - 1.f) / zoom);
+    box[BOXTOP]    = (int) SDL_ceil((originY + MAP_TILE_SIZE + 1.f) / zoom);
+    batchMapLines(view, box, zoom);
+
+    buildBatchQuads(view, map->vertexX, map->vertexY, zoom, -originX, -originY);
+
+    Texture *target = renderer->target;
+    setRenderTarget(renderer, tile->texture);
+    setRenderColor(renderer, 0x00, 0x00, 0x00, 0x00);
+    renderClear(renderer);
+    drawBatch(view, map->vertexX, map->vertexY, zoom, -originX, -originY);
+    setRenderTarget(renderer, target);
+
+    // The batch no longer holds the lines in view
+    view->linesDirty = true;
+
+    tile->valid = true;
+    view->tilesRendered++;
+}
+
+//
+// Get the tile at the level and tile coordinates, rendering it into the least recently used slot if needed
+//
+static MapTile *getMapTile(MapView *view, int level, int x, int y) {
+    MapTile *slot = NULL;
+    unsigned long slotLastUsed = 0;
+    for (int i = 0; i < MAP_VIEW_MAX_TILES; ++i) {
+        MapTile *tile = &view->tiles[i];
+        if (tile->valid && tile->level == level && tile->x == x && tile->y == y) {
+            tile->lastUsed = view->frame;
+            return tile;
+        }
+        // Invalid tiles go first, frames are counted from 1
+        const unsigned long lastUsed = tile->valid ? tile->lastUsed : 0;
+        if (slot == NULL || lastUsed < slotLastUsed) {
+            slot = tile;
+            slotLastUsed = lastUsed;
+        }
+    }
+
+    if (slot->texture == NULL) {
+        slot->texture = createTargetTexture(view->renderer, MAP_TILE_SIZE, MAP_TILE_SIZE, "map tile");
+        if (slot->texture == NULL) {
+            LOG_WARN("Failed to create map tile texture, drawing map lines directly: %s", SDL_GetError());
+            view->useTiles = false;
+            return NULL;
+        }
+    }
+
+    *slot = (MapTile) {
+            .texture = slot->texture,
+            .level = level,
+            .x = x, .y = y,
+            .lastUsed = view->frame
+    };
+    renderMapTile(view, slot);
+    return slot;
+}
+
+//
+// Draw the linedef layer from the tiles in view, stretched from their level to the camera's zoom,
+// returns false if it needs drawing directly
+//
+static bool drawMapTiles(MapView *view, const Camera *camera) {
+    const int level = getTileLevel(camera->zoom);
+    const float tileZoom = getTileZoom(level);
+    const float stretch = camera->zoom / tileZoom;
+
+    // The view in pixels at the tile level
+    const float left   = -camera->offsetX / stretch;
+    const float top    = -camera->offsetY / stretch;
+    const float right  = ((float) view->viewWidth  - camera->offsetX) / stretch;
+    const float bottom = ((float) view->viewHeight - camera->offsetY) / stretch;
+    const int firstX = (int) SDL_floor(left / MAP_TILE_SIZE);
+    const int firstY = (int) SDL_floor(top / MAP_TILE_SIZE);
+    const int lastX = (int) SDL_floor(right / MAP_TILE_SIZE);
+    const int lastY = (int) SDL_floor(bottom / MAP_TILE_SIZE);
+    if ((lastX - firstX + 1) * (lastY - firstY + 1) > MAP_VIEW_MAX_TILES) {
+        // More tiles in view than there's room for, they'd be rendered over each other every frame
+        return false;
+    }
+
+    // Skip the tiles outside of the map entirely, allowing a pixel for the width of the lines
+    const short *box = view->map->bounds.box;
+    const int mapFirstX = (int) SDL_floor((box[BOXLEFT]   * tileZoom - 1.f) / MAP_TILE_SIZE);
+    const int mapFirstY = (int) SDL_floor((box[BOXBOTTOM] * tileZoom - 1.f) / MAP_TILE_SIZE);
+    const int mapLastX  = (int) SDL_floor((box[BOXRIGHT]  * tileZoom + 1.f) / MAP_TILE_SIZE);
+    const int mapLastY  = (int) SDL_floor((box[BOXTOP]    * tileZoom + 1.f) / MAP_TILE_SIZE);
+    const float size = MAP_TILE_SIZE * stretch;
+    for (int y = MAX(firstY, mapFirstY); y <= MIN(lastY, mapLastY); ++y) {
+        for (int x = MAX(firstX, mapFirstX); x <= MIN(lastX, mapLastX); ++x) {
+            const MapTile *tile = getMapTile(view, level, x, y);
+            if (tile == NULL) return false;
+
+            const SDL_FRect dst = {
+                    .x = (float) x * size + camera->offsetX,
+                    .y = (float) y * size + camera->offsetY,
+                    .w = size, .h = size
+            };
+            renderCopyF(view->renderer, tile->texture, NULL, &dst);
+        }
+    }
+    return true;
+}
+
+//
+// Draw the lines in view straight to the screen, batching them again only when the view
+// has left the batched box, or the zoom or view size have changed
+//
+static void drawMapLines(MapView *view, const Camera *camera) {
+    if (view->verticesDirty) {
+        const map_t *map = view->map;
+        transformPoints(map->vertexX, map->vertexY, map->numVertexes, view->zoom, 0.f, 0.f,
+                        view->vertexX, view->vertexY);
+        view->verticesDirty = false;
+    }
+
+    // The view in map units, with a pixel of margin for the width of the lines
+    const float margin = camera->inverseZoom;
+    const int left   = (int) SDL_floor(camera->x - margin);
+    const int right  = (int) SDL_ceil(camera->x + (float) view->viewWidth * camera->inverseZoom + margin);
+    const int bottom = (int) SDL_floor(camera->y - margin);
+    const int top    = (int) SDL_ceil(camera->y + (float) view->viewHeight * camera->inverseZoom + margin);
+
+    int *box = view->batchBox;
+    if (view->linesDirty || left < box[BOXLEFT] || right > box[BOXRIGHT] || bottom < box[BOXBOTTOM] || top > box[BOXTOP]) {
+        const float batchMargin = MAP_VIEW_BATCH_MARGIN * camera->inverseZoom;
+        box[BOXLEFT]   = (int) SDL_floor((float) left - batchMargin);
+        box[BOXRIGHT]  = (int) SDL_ceil((float) right + batchMargin);
+        box[BOXBOTTOM] = (int) SDL_floor((float) bottom - batchMargin);
+        box[BOXTOP]    = (int) SDL_ceil((float) top + batchMargin);
+        batchMapLines(view, box, camera->zoom);
+        buildBatchQuads(view, view->vertexX, view->vertexY, 1.f, 0.f, 0.f);
+        view->linesDirty = false;
+        view->batches++;
+    }
+    setRenderOrigin(view->renderer, camera->offsetX, camera->offsetY);
+    drawBatch(view, view->vertexX, view->vertexY, 1.f, 0.f, 0.f);
+    setRenderOrigin(view->renderer, 0.f, 0.f);
+}
+
+void renderMapView(MapView *view, const Camera *camera) {
+    assert(view != NULL && camera != NULL);
+
+    Renderer *renderer = view->renderer;
+    const map_t *map = view->map;
+    if (map == NULL) return;
+    view->frame++;
+
+    int width, height;
+    getRendererSize(renderer, &width, &height);
+    if (width != view->viewWidth || height != view->viewHeight) {
+        view->viewWidth = width;
+        view->viewHeight = height;
+        view->linesDirty = true;
+    }
+
+    // A zoom scales the whole map again, a pan only moves the origin it's drawn at
+    if (view->dirty || camera->zoom != view->zoom) {
+        updateMapViewGeometry(view, camera->zoom);
+    }
+
+    // Draw linedefs from the tiles, or directly
+    if (!view->useTiles || !drawMapTiles(view, camera)) {
+        drawMapLines(view, camera);
+    }
+
+    // Draw things, the markers filled a batch per class, then all outlined at once
+    setRenderOrigin(renderer, camera->offsetX, camera->offsetY);
+    for (int c = 0; c < NUM_THING_CLASSES; ++c) {
+        const int first = map->thingClassStart[c];
+        const int count = map->thingClassStart[c + 1] - first;
+        if (count == 0) continue;
+
+        const SDL_Color color = thingClassColors[c];
+        setRenderColor(renderer, color.r, color.g, color.b, color.a);
+        renderFillRectsF(renderer, &view->thingRects[first], count);
+    }
+    if (map->numThings > 0) {
+        setRenderColor(renderer, 0x00, 0xFF, 0x00, 0xFF);
+        renderDrawRectsF(renderer, view->thingRects, map->numThings);
+    }
+    setRenderOrigin(renderer, 0.f, 0.f);
+    setRenderColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+
+    // Draw map bounds rect
+    const short *box = map->bounds.box;
+    const float left   = box[BOXLEFT]   * camera->zoom + camera->offsetX;
+    const float top    = box[BOXBOTTOM] * camera->zoom + camera->offsetY;
+    const float mapWidth  = (box[BOXRIGHT] - box[BOXLEFT])   * camera->zoom;
+    const float mapHeight = (box[BOXTOP]   - box[BOXBOTTOM]) * camera->zoom;
+    SDL_FRect rect = (SDL_FRect) {
+            .x = left, .y = top,
+            .w = mapWidth, .h = mapHeight
+    };
+    setRenderColor(renderer, 0x00, 0x00, 0xFF, 0xFF);
+    renderDrawRectsF(renderer, &rect, 1);
+
+    // Draw map bounds rect min x,y
+    const float size = 10.f;
+    rect = (SDL_FRect) {
+            .x = left - (size / 2), .y = top - (size / 2),
+            .w = size, .h = size
+    };
+    setRenderColor(renderer, 0x00, 0x00, 0xFF, 0xFF);
+    renderFillRectsF(renderer, &rect, 1);
+
+    // Draw map bounds rect center
+    rect = (SDL_FRect) {
+            .x = rect.x + (mapWidth  / 2),
+            .y = rect.y + (mapHeight / 2),
+            .w = size, .h = size
+    };
+    setRenderColor(renderer, 0xAA, 0x00, 0xAA, 0xFF);
+    renderFillRectsF(renderer, &rect, 1);
+
+    setRenderColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+}
+
+void destroyMapView(MapView *view) {
+    if (view == NULL) return;
+    freeMapViewBuffers(view);
+    for (int i = 0; i < MAP_VIEW_MAX_TILES; ++i) {
+        if (view->tiles[i].texture != NULL) {
+            destroyTexture(view->tiles[i].texture);
+        }
+    }
+    free(view);
+}
@@ -0,0 +1,101 @@
+#ifndef SERAPH_MAP_VIEW_H
+#define SERAPH_MAP_VIEW_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+#include "camera.h"
+#include "renderer.h"
+#include "texture.h"
+#include "doom/doom_utils.h"
+#include "doom/map_lod.h"
+
+// SDL_RenderGeometry draws every line in view as one batch of quads colored by class,
+// older SDLs and the software renderer fall back to drawing lines, one draw color per class
+#define MAP_VIEW_GEOMETRY RENDERER_GEOMETRY
+
+// The linedef layer is rendered into tiles this many pixels square, at each zoom level as it's viewed.
+// 64 tiles of 256x256 RGBA are 16MB of texture memory, enough to cover a 1080p window.
+#define MAP_TILE_SIZE 256
+#define MAP_VIEW_MAX_TILES 64
+
+// Tiles are rendered at zoom levels this many to a doubling, the level at or below the camera's
+// zoom is stretched to fit it. A level per CAMERA_ZOOM_STEP, so stepped zooms draw tiles 1:1.
+#define MAP_TILE_LEVELS_PER_DOUBLING 4
+
+// Lines drawn directly are batched for this many pixels around the view,
+// so panning only batches them again once it has moved that far
+#define MAP_VIEW_BATCH_MARGIN MAP_TILE_SIZE
+
+// A tile of the linedef layer at one zoom level, reused least recently used first
+typedef struct MapTile {
+    Texture *texture;
+    bool valid;
+    int level; // zoom 2^(level / MAP_TILE_LEVELS_PER_DOUBLING)
+    int x; // in tiles from the map origin at the level's zoom
+    int y;
+    unsigned long lastUsed; // frame
+} MapTile;
+
+// Draws a map, caching its geometry scaled to the camera's zoom until the map or zoom change.
+// The camera's position is a screen offset, the renderer's origin as the cached geometry is drawn.
+typedef struct MapView {
+    Renderer *renderer;
+    const map_t *map;
+    // The zoom the geometry was scaled for, dirty when it needs scaling whatever the zoom.
+    // Tiles are drawn from the map's own vertices, so they're only scaled once lines are drawn directly.
+    bool dirty;
+    bool verticesDirty;
+    float zoom;
+    // The batch holds the lines in batchBox when they're drawn directly, out of date once this is set
+    bool linesDirty;
+    int batchBox[4];
+    int viewWidth;
+    int viewHeight;
+    // Tile cache, unused when the renderer can't render to textures
+    bool useTiles;
+    unsigned long frame;
+    MapTile tiles[MAP_VIEW_MAX_TILES];
+    // Counters
+    unsigned long transforms;
+    unsigned long batches;
+    unsigned long tilesRendered;
+    int linesDrawn; // by the last batch
+    int lodLevel;   // of the last batch, -1 for full detail
+    // The buffers below are sized for the biggest map viewed so far, so switching maps rarely reallocates them
+    int vertexCapacity;
+    int thingCapacity;
+    int nodeCapacity;
+    int subsectorCapacity;
+    int lineCapacity;
+    // Positions scaled to the zoom, relative to the map origin on screen
+    float *points;
+    float *vertexX;
+    float *vertexY;
+    float *thingX;
+    float *thingY;
+    // Scratch space for walking the BSP
+    int *nodeStack;
+    int *subsectors;
+    // Lines found in a box, segs or linedefs at full detail, then sorted by class into the batch,
+    // batch[batchClassStart[c]] up to batch[batchClassStart[c + 1]]
+    mapline_t *found;
+    mapline_t *batch;
+    int batchClassStart[NUM_LINEDEF_CLASSES + 1];
+    SDL_FPoint *batchPoints; // two per batched line, when drawn as lines
+#if MAP_VIEW_GEOMETRY
+    SDL_Vertex *batchVertices; // four per batched line
+    int *batchIndices;         // six per batched line
+#endif
+    // A marker around each of the map's things, in the map's class order
+    SDL_FRect *thingRects;
+} MapView;
+
+MapView *createMapView(Renderer *renderer);
+void setMapViewMap(MapView *view, const map_t *map);
+void invalidateMapViewTiles(MapView *view);
+void renderMapView(MapView *view, const Camera *camera);
+void destroyMapView(MapView *view);
+
+#endif //SERAPH_MAP_VIEW_H
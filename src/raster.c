@@ -0,0 +1,276 @@
+#include <assert.h>
+#include <stdbool.h>
+
+#include "raster.h"
+#include "common.h"
+
+#ifdef SERAPH_SSE2
+#include <emmintrin.h>
+#endif
+
+static Uint32 *getRasterRow(SDL_Surface *surface, int y) {
+    return (Uint32 *) ((Uint8 *) surface->pixels + (size_t) y * surface->pitch);
+}
+
+//
+// Fill a run of pixels, four at a time where there's SSE2
+//
+static void fillSpan(Uint32 *pixels, int count, Uint32 color) {
+    int i = 0;
+#ifdef SERAPH_SSE2
+    const __m128i fill = _mm_set1_epi32((int) color);
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i *) &pixels[i], fill);
+    }
+#endif
+    for (; i < count; ++i) {
+        pixels[i] = color;
+    }
+}
+
+static bool clipRect(const SDL_Surface *target, const SDL_Rect *rect, SDL_Rect *clipped) {
+    const int x0 = MAX(rect->x, 0);
+    const int y0 = MAX(rect->y, 0);
+    const int x1 = MIN(rect->x + rect->w, target->w);
+    const int y1 = MIN(rect->y + rect->h, target->h);
+    *clipped = (SDL_Rect) { x0, y0, x1 - x0, y1 - y0 };
+    return clipped->w > 0 && clipped->h > 0;
+}
+
+static void drawHorizontalLine(SDL_Surface *target, int x0, int x1, int y, Uint32 color) {
+    if (y < 0 || y >= target->h) return;
+    if (x0 > x1) { const int x = x0; x0 = x1; x1 = x; }
+    x0 = MAX(x0, 0);
+    x1 = MIN(x1, target->w - 1);
+    if (x0 > x1) return;
+    fillSpan(getRasterRow(target, y) + x0, x1 - x0 + 1, color);
+}
+
+static void drawVerticalLine(SDL_Surface *target, int x, int y0, int y1, Uint32 color) {
+    if (x < 0 || x >= target->w) return;
+    if (y0 > y1) { const int y = y0; y0 = y1; y1 = y; }
+    y0 = MAX(y0, 0);
+    y1 = MIN(y1, target->h - 1);
+    for (int y = y0; y <= y1; ++y) {
+        getRasterRow(target, y)[x] = color;
+    }
+}
+
+void rasterClear(SDL_Surface *target, Uint32 color) {
+    assert(target != NULL && target->format->format == SDL_PIXELFORMAT_ARGB8888);
+
+    for (int y = 0; y < target->h; ++y) {
+        fillSpan(getRasterRow(target, y), target->w, color);
+    }
+}
+
+void rasterFillRects(SDL_Surface *target, const SDL_Rect *rects, int count, Uint32 color) {
+    assert(target != NULL && (rects != NULL || count == 0));
+
+    for (int i = 0; i < count; ++i) {
+        SDL_Rect rect;
+        if (!clipRect(target, &rects[i], &rect)) continue;
+        for (int y = rect.y; y < rect.y + rect.h; ++y) {
+            fillSpan(getRasterRow(target, y) + rect.x, rect.w, color);
+        }
+    }
+}
+
+void rasterDrawRects(SDL_Surface *target, const SDL_Rect *rects, int count, Uint32 color) {
+    assert(target != NULL && (rects != NULL || count == 0));
+
+    for (int i = 0; i < count; ++i) {
+        const SDL_Rect *rect = &rects[i];
+        if (rect->w <= 0 || rect->h <= 0) continue;
+        const int right = rect->x + rect->w - 1;
+        const int bottom = rect->y + rect->h - 1;
+        drawHorizontalLine(target, rect->x, right, rect->y, color);
+        drawHorizontalLine(target, rect->x, right, bottom, color);
+        drawVerticalLine(target, rect->x, rect->y, bottom, color);
+        drawVerticalLine(target, right, rect->y, bottom, color);
+    }
+}
+
+//
+// Liang-Barsky clip of a line to the target, false if none of it is inside
+//
+static bool clipLine(const SDL_Surface *target, int *x0, int *y0, int *x1, int *y1) {
+    const double dx = *x1 - *x0;
+    const double dy = *y1 - *y0;
+    const double p[4] = { -dx, dx, -dy, dy };
+    const double q[4] = { *x0, target->w - 1 - *x0, *y0, target->h - 1 - *y0 };
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0) {
+            if (q[i] < 0.0) return false;
+            continue;
+        }
+        const double t = q[i] / p[i];
+        if (p[i] < 0.0) {
+            if (t > t1) return false;
+            t0 = MAX(t0, t);
+        } else {
+            if (t < t0) return false;
+            t1 = MIN(t1, t);
+        }
+    }
+
+    // Rounding can land a hair outside
+    const int startX = *x0;
+    const int startY = *y0;
+    *x0 = MAX(0, MIN((int) SDL_floor(startX + t0 * dx + 0.5), target->w - 1));
+    *y0 = MAX(0, MIN((int) SDL_floor(startY + t0 * dy + 0.5), target->h - 1));
+    *x1 = MAX(0, MIN((int) SDL_floor(startX + t1 * dx + 0.5), target->w - 1));
+    *y1 = MAX(0, MIN((int) SDL_floor(startY + t1 * dy + 0.5), target->h - 1));
+    return true;
+}
+
+//
+// Draw a clipped line a pixel per step along its major axis, stepping 16.16 fixed point positions
+//
+static void drawClippedLine(SDL_Surface *target, int x0, int y0, int x1, int y1, Uint32 color) {
+    const int dx = x1 - x0;
+    const int dy = y1 - y0;
+    const int steps = MAX(abs(dx), abs(dy));
+    const int stepX = (int) (((Sint64) dx * 65536) / MAX(steps, 1));
+    const int stepY = (int) (((Sint64) dy * 65536) / MAX(steps, 1));
+    const int startX = (x0 << 16) + 0x8000;
+    const int startY = (y0 << 16) + 0x8000;
+    Uint8 *pixels = (Uint8 *) target->pixels;
+    const int pitch = target->pitch;
+
+    for (int i = 0; i <= steps; ++i) {
+        const int px = (startX + i * stepX) >> 16;
+        const int py = (startY + i * stepY) >> 16;
+        ((Uint32 *) (pixels + (size_t) py * pitch))[px] = color;
+    }
+}
+
+//
+// Draw count lines, from points[2 * i] to points[2 * i + 1]
+//
+void rasterDrawLines(SDL_Surface *target, const SDL_Point *points, int count, Uint32 color) {
+    assert(target != NULL && (points != NULL || count == 0));
+
+    for (int i = 0; i < count; ++i) {
+        int x0 = points[2 * i].x, y0 = points[2 * i].y;
+        int x1 = points[2 * i + 1].x, y1 = points[2 * i + 1].y;
+        // Doom's walls are mostly axis aligned
+        if (y0 == y1) {
+            drawHorizontalLine(target, x0, x1, y0, color);
+        } else if (x0 == x1) {
+            drawVerticalLine(target, x0, y0, y1, color);
+        } else if (clipLine(target, &x0, &y0, &x1, &y1)) {
+            drawClippedLine(target, x0, y0, x1, y1, color);
+        }
+    }
+}
+
+// Source over destination by the source's alpha
+static Uint32 blendPixel(Uint32 src, Uint32 dst) {
+    const Uint32 alpha = src >> 24;
+    if (alpha == 0xFF) return src;
+    if (alpha == 0) return dst;
+
+    const Uint32 inverse = 0xFF - alpha;
+    const Uint32 r = (((src >> 16) & 0xFF) * alpha + ((dst >> 16) & 0xFF) * inverse + 127) / 255;
+    const Uint32 g = (((src >> 8)  & 0xFF) * alpha + ((dst >> 8)  & 0xFF) * inverse + 127) / 255;
+    const Uint32 b = (( src        & 0xFF) * alpha + ( dst        & 0xFF) * inverse + 127) / 255;
+    const Uint32 a = alpha + ((dst >> 24) * inverse + 127) / 255;
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+//
+// Copy without rotation, stepping 16.16 fixed point source positions across each row
+//
+static void copyAxisAligned(SDL_Surface *target, SDL_Surface *source, const SDL_Rect *src, const SDL_Rect *dest,
+                            SDL_RendererFlip flip) {
+    SDL_Rect clipped;
+    if (!clipRect(target, dest, &clipped)) return;
+
+    const int stepU = (int) (((Sint64) src->w << 16) / dest->w);
+    const int stepV = (int) (((Sint64) src->h << 16) / dest->h);
+    const int startU = stepU / 2 + (clipped.x - dest->x) * stepU;
+    int v = stepV / 2 + (clipped.y - dest->y) * stepV;
+    for (int y = clipped.y; y < clipped.y + clipped.h; ++y, v += stepV) {
+        const int row = (flip & SDL_FLIP_VERTICAL) ? src->h - 1 - (v >> 16) : (v >> 16);
+        const Uint32 *sourceRow = getRasterRow(source, src->y + row) + src->x;
+        Uint32 *targetRow = getRasterRow(target, y);
+
+        int u = startU;
+        for (int x = clipped.x; x < clipped.x + clipped.w; ++x, u += stepU) {
+            const int column = (flip & SDL_FLIP_HORIZONTAL) ? src->w - 1 - (u >> 16) : (u >> 16);
+            targetRow[x] = blendPixel(sourceRow[column], targetRow[x]);
+        }
+    }
+}
+
+//
+// Copy rotated clockwise about the center, mapping each target pixel in the rotated bounds back to the source
+//
+static void copyRotated(SDL_Surface *target, SDL_Surface *source, const SDL_Rect *src, const SDL_Rect *dest,
+                        double angle, const SDL_Point *center, SDL_RendererFlip flip) {
+    const float centerX = (float) dest->x + ((center != NULL) ? (float) center->x : 0.5f * (float) dest->w);
+    const float centerY = (float) dest->y + ((center != NULL) ? (float) center->y : 0.5f * (float) dest->h);
+    const double radians = angle * M_PI / 180.0;
+    const float cosAngle = (float) SDL_cos(radians);
+    const float sinAngle = (float) SDL_sin(radians);
+
+    // Bounds of the rotated corners
+    float minX = centerX, maxX = centerX, minY = centerY, maxY = centerY;
+    for (int i = 0; i < 4; ++i) {
+        const float cornerX = (float) (dest->x + ((i & 1) ? dest->w : 0)) - centerX;
+        const float cornerY = (float) (dest->y + ((i & 2) ? dest->h : 0)) - centerY;
+        const float x = centerX + cornerX * cosAngle - cornerY * sinAngle;
+        const float y = centerY + cornerX * sinAngle + cornerY * cosAngle;
+        minX = MIN(minX, x); maxX = MAX(maxX, x);
+        minY = MIN(minY, y); maxY = MAX(maxY, y);
+    }
+    const SDL_Rect bounds = {
+            (int) SDL_floor(minX), (int) SDL_floor(minY),
+            (int) SDL_ceil(maxX) - (int) SDL_floor(minX), (int) SDL_ceil(maxY) - (int) SDL_floor(minY)
+    };
+    SDL_Rect clipped;
+    if (!clipRect(target, &bounds, &clipped)) return;
+
+    const float scaleU = (float) src->w / (float) dest->w;
+    const float scaleV = (float) src->h / (float) dest->h;
+    for (int y = clipped.y; y < clipped.y + clipped.h; ++y) {
+        Uint32 *targetRow = getRasterRow(target, y);
+        const float offsetY = (float) y + 0.5f - centerY;
+        for (int x = clipped.x; x < clipped.x + clipped.w; ++x) {
+            // Rotate the pixel center back counterclockwise into dest
+            const float offsetX = (float) x + 0.5f - centerX;
+            const float localX = centerX + offsetX * cosAngle + offsetY * sinAngle - (float) dest->x;
+            const float localY = centerY - offsetX * sinAngle + offsetY * cosAngle - (float) dest->y;
+            if (localX < 0.f || localY < 0.f || localX >= (float) dest->w || localY >= (float) dest->h) continue;
+
+            int column = MIN((int) (localX * scaleU), src->w - 1);
+            int row = MIN((int) (localY * scaleV), src->h - 1);
+            if (flip & SDL_FLIP_HORIZONTAL) column = src->w - 1 - column;
+            if (flip & SDL_FLIP_VERTICAL)   row = src->h - 1 - row;
+            targetRow[x] = blendPixel(getRasterRow(source, src->y + row)[src->x + column], targetRow[x]);
+        }
+    }
+}
+
+void rasterCopy(SDL_Surface *target, SDL_Surface *source, const SDL_Rect *src, const SDL_Rect *dest,
+                double angle, const SDL_Point *center, SDL_RendererFlip flip) {
+    assert(target != NULL && source != NULL);
+    assert(source->format->format == SDL_PIXELFORMAT_ARGB8888);
+
+    // NULL rects are the whole source and the whole target, like SDL_RenderCopyEx
+    const SDL_Rect wholeSource = { 0, 0, source->w, source->h };
+    const SDL_Rect wholeTarget = { 0, 0, target->w, target->h };
+    SDL_Rect srcRect;
+    if (!clipRect(source, (src != NULL) ? src : &wholeSource, &srcRect)) return;
+    if (dest == NULL) dest = &wholeTarget;
+    if (dest->w <= 0 || dest->h <= 0) return;
+
+    if (angle == 0.0) {
+        copyAxisAligned(target, source, &srcRect, dest, flip);
+    } else {
+        copyRotated(target, source, &srcRect, dest, angle, center, flip);
+    }
+}
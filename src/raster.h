@@ -0,0 +1,17 @@
+#ifndef SERAPH_RASTER_H
+#define SERAPH_RASTER_H
+
+#include "SDL.h"
+
+// CPU rasterization into ARGB8888 surfaces, clipped to the target. Fills and lines overwrite the target
+// like SDL's default draw blend mode, copies blend the source over it by its alpha like a blended texture.
+// Copies sample the nearest source pixel, so the same calls give the same bytes on any machine.
+
+void rasterClear(SDL_Surface *target, Uint32 color);
+void rasterFillRects(SDL_Surface *target, const SDL_Rect *rects, int count, Uint32 color);
+void rasterDrawRects(SDL_Surface *target, const SDL_Rect *rects, int count, Uint32 color);
+void rasterDrawLines(SDL_Surface *target, const SDL_Point *points, int count, Uint32 color);
+void rasterCopy(SDL_Surface *target, SDL_Surface *source, const SDL_Rect *src, const SDL_Rect *dest,
+                double angle, const SDL_Point *center, SDL_RendererFlip flip);
+
+#endif //SERAPH_RASTER_H
@@ -0,0 +1,136 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "render_commands.h"
+#include "common.h"
+
+CommandBuffer *createCommandBuffer(int maxCommands) {
+    assert(maxCommands > 0);
+
+    CommandBuffer *buffer = (CommandBuffer *) calloc(1, sizeof(CommandBuffer));
+    buffer->lock = SDL_CreateMutex();
+    if (buffer->lock == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create command buffer lock: %s", SDL_GetError());
+        exit(1);
+    }
+    for (int i = 0; i < 3; ++i) {
+        buffer->lists[i].maxCommands = maxCommands;
+        buffer->lists[i].commands = (RenderCommand *) calloc((size_t) maxCommands, sizeof(RenderCommand));
+    }
+    buffer->published = 0;
+    buffer->writing = 0;
+    buffer->ready = 1;
+    buffer->reading = 2;
+    buffer->fresh = false;
+    return buffer;
+}
+
+//
+// Start filling the list the writer owns, only the writer may call this
+//
+RenderCommandList *beginCommandList(CommandBuffer *buffer) {
+    assert(buffer != NULL);
+
+    RenderCommandList *list = &buffer->lists[buffer->writing];
+    list->numCommands = 0;
+    list->entities.count = 0;
+    list->changed = false;
+    list->moving = false;
+    return list;
+}
+
+RenderCommand *pushRenderCommand(RenderCommandList *list, enum RenderCommandType type) {
+    assert(list != NULL);
+
+    if (list->numCommands == list->maxCommands) {
+        list->maxCommands *= 2;
+        list->commands = (RenderCommand *) realloc(list->commands, list->maxCommands * sizeof(RenderCommand));
+    }
+    RenderCommand *command = &list->commands[list->numCommands++];
+    command->type = type;
+    command->color = (SDL_Color) { 0xFF, 0xFF, 0xFF, 0xFF };
+    return command;
+}
+
+//
+// Copy what's drawn of the entities into the list, an array at a time
+//
+void copyRenderEntities(RenderCommandList *list, const EntityStore *store) {
+    assert(list != NULL && store != NULL);
+
+    RenderEntities *entities = &list->entities;
+    const int count = store->count;
+    if (count > entities->capacity) {
+        const size_t n = (size_t) MAX(count, 2 * entities->capacity);
+        entities->x        = (float *) realloc(entities->x, n * sizeof(float));
+        entities->y        = (float *) realloc(entities->y, n * sizeof(float));
+        entities->angle    = (float *) realloc(entities->angle, n * sizeof(float));
+        entities->facing   = (unsigned char *) realloc(entities->facing, n * sizeof(unsigned char));
+        entities->keyframe = (const TextureRegion **) realloc(entities->keyframe, n * sizeof(TextureRegion *));
+        entities->capacity = (int) n;
+    }
+    SDL_memcpy(entities->x, store->x, count * sizeof(float));
+    SDL_memcpy(entities->y, store->y, count * sizeof(float));
+    SDL_memcpy(entities->angle, store->angle, count * sizeof(float));
+    SDL_memcpy(entities->facing, store->facing, count * sizeof(unsigned char));
+    SDL_memcpy(entities->keyframe, store->keyframe, count * sizeof(TextureRegion *));
+    entities->count = count;
+}
+
+//
+// Make the writer's list the newest, the writer carries on with the list it replaces
+//
+void publishCommandList(CommandBuffer *buffer) {
+    assert(buffer != NULL);
+
+    RenderCommandList *list = &buffer->lists[buffer->writing];
+    list->sequence = ++buffer->published;
+
+    SDL_LockMutex(buffer->lock);
+    {
+        // A change in a list the reader never saw still has to be drawn
+        if (buffer->fresh && buffer->lists[buffer->ready].changed) {
+            list->changed = true;
+        }
+        const int ready = buffer->ready;
+        buffer->ready = buffer->writing;
+        buffer->writing = ready;
+        buffer->fresh = true;
+    }
+    SDL_UnlockMutex(buffer->lock);
+}
+
+//
+// The newest published list, only the reader may call this. It stays the reader's
+// until the next call, an empty list with sequence 0 until anything is published.
+//
+const RenderCommandList *acquireCommandList(CommandBuffer *buffer) {
+    assert(buffer != NULL);
+
+    SDL_LockMutex(buffer->lock);
+    {
+        if (buffer->fresh) {
+            const int reading = buffer->reading;
+            buffer->reading = buffer->ready;
+            buffer->ready = reading;
+            buffer->fresh = false;
+        }
+    }
+    SDL_UnlockMutex(buffer->lock);
+    return &buffer->lists[buffer->reading];
+}
+
+void destroyCommandBuffer(CommandBuffer *buffer) {
+    if (buffer == NULL) return;
+    for (int i = 0; i < 3; ++i) {
+        RenderCommandList *list = &buffer->lists[i];
+        free(list->commands);
+        free(list->entities.x);
+        free(list->entities.y);
+        free(list->entities.angle);
+        free(list->entities.facing);
+        free(list->entities.keyframe);
+    }
+    SDL_DestroyMutex(buffer->lock);
+    free(buffer);
+}
@@ -0,0 +1,88 @@
+#ifndef SERAPH_RENDER_COMMANDS_H
+#define SERAPH_RENDER_COMMANDS_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+#include "camera.h"
+#include "entity_store.h"
+#include "texture_region.h"
+#include "doom/doom_utils.h"
+
+enum RenderCommandType { RENDER_CLEAR, RENDER_SPRITE, RENDER_MAP, RENDER_ENTITIES };
+
+// Something to draw, copied out of the simulation or pointing at what it never changes, like
+// texture regions and maps, so drawing it never reads simulation state.
+// What moves is given at the previous tick and the current one, frames draw in between.
+typedef struct RenderCommand {
+    enum RenderCommandType type;
+    SDL_Color color;
+    union {
+        struct {
+            const TextureRegion *region;
+            SDL_Rect dest;
+            double prevAngle;
+            double angle;
+            SDL_RendererFlip flip;
+        } sprite;
+        struct {
+            const map_t *map;
+            unsigned long mapSwitch; // counts the switches to it, so a map switched to again is told apart
+            Camera prevCamera;
+            Camera camera;
+        } map;
+        struct {
+            Camera prevCamera;
+            Camera camera;
+        } entities;
+    } u;
+} RenderCommand;
+
+// What's drawn of the entity store, copied array by array into the list that draws it
+typedef struct RenderEntities {
+    int count;
+    int capacity;
+    float *x; // map units
+    float *y;
+    float *angle;
+    unsigned char *facing;
+    const TextureRegion **keyframe;
+} RenderEntities;
+
+// Everything to draw for the simulation's state at one point in time
+typedef struct RenderCommandList {
+    unsigned long sequence;
+    Uint64 time;  // microseconds, when the list was published
+    unsigned long ticks; // simulated by then
+    double alpha; // how far past the last tick the simulation was then, in ticks
+    bool changed; // draws differently than the list before it
+    bool moving;  // draws differently depending on alpha
+    int numCommands;
+    int maxCommands;
+    RenderCommand *commands;
+    RenderEntities entities; // drawn by RENDER_ENTITIES
+} RenderCommandList;
+
+// Triple buffered command lists. The update thread fills one while the render
+// thread draws another, the third holds the newest list that's been published.
+typedef struct CommandBuffer {
+    SDL_mutex *lock;
+    RenderCommandList lists[3];
+    unsigned long published;
+    // Guarded by lock
+    int writing;
+    int ready;
+    int reading;
+    bool fresh; // ready hasn't been acquired yet
+} CommandBuffer;
+
+CommandBuffer *createCommandBuffer(int maxCommands);
+RenderCommandList *beginCommandList(CommandBuffer *buffer);
+RenderCommand *pushRenderCommand(RenderCommandList *list, enum RenderCommandType type);
+void copyRenderEntities(RenderCommandList *list, const EntityStore *store);
+void publishCommandList(CommandBuffer *buffer);
+const RenderCommandList *acquireCommandList(CommandBuffer *buffer);
+void destroyCommandBuffer(CommandBuffer *buffer);
+
+#endif //SERAPH_RENDER_COMMANDS_H
@@ -0,0 +1,380 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "renderer.h"
+#include "common.h"
+#include "raster.h"
+#include "texture.h"
+
+static SDL_Surface *createFramebuffer(int width, int height) {
+    SDL_Surface *framebuffer = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (framebuffer == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create %dx%d framebuffer: %s", width, height, SDL_GetError());
+        exit(1);
+    }
+    // Presented as it is, whatever's been cleared into its alpha
+    SDL_SetSurfaceBlendMode(framebuffer, SDL_BLENDMODE_NONE);
+    return framebuffer;
+}
+
+Renderer *createRenderer(SDL_Window *window, Uint32 flags) {
+    assert(window != NULL);
+
+    SDL_Renderer *sdl = SDL_CreateRenderer(window, -1, flags);
+    if (sdl == NULL) {
+        SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create renderer: %s", SDL_GetError());
+        exit(1);
+    }
+
+    Renderer *renderer = (Renderer *) calloc(1, sizeof(Renderer));
+    renderer->backend = RENDERER_SDL;
+    renderer->window = window;
+    renderer->sdl = sdl;
+    setRenderColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    return renderer;
+}
+
+//
+// A renderer that rasterizes on the CPU, presenting to the window if there is one
+//
+Renderer *createSoftwareRenderer(SDL_Window *window, int width, int height) {
+    assert(width > 0 && height > 0);
+
+    Renderer *renderer = (Renderer *) calloc(1, sizeof(Renderer));
+    renderer->backend = RENDERER_SOFTWARE;
+    renderer->window = window;
+    renderer->framebuffer = createFramebuffer(width, height);
+    setRenderColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF);
+    return renderer;
+}
+
+//
+// Match the framebuffer to a new window size, SDL renderers follow their window by themselves
+//
+void resizeRenderer(Renderer *renderer, int width, int height) {
+    assert(renderer != NULL);
+
+    if (renderer->backend != RENDERER_SOFTWARE || width <= 0 || height <= 0) return;
+    if (renderer->framebuffer->w == width && renderer->framebuffer->h == height) return;
+
+    SDL_FreeSurface(renderer->framebuffer);
+    renderer->framebuffer = createFramebuffer(width, height);
+}
+
+void getRendererSize(const Renderer *renderer, int *width, int *height) {
+    assert(renderer != NULL && width != NULL && height != NULL);
+
+    if (renderer->backend == RENDERER_SDL) {
+        if (SDL_GetRendererOutputSize(renderer->sdl, width, height) != 0) {
+            *width = *height = 0;
+        }
+    } else {
+        *width = renderer->framebuffer->w;
+        *height = renderer->framebuffer->h;
+    }
+}
+
+bool renderTargetSupported(const Renderer *renderer) {
+    assert(renderer != NULL);
+
+    return renderer->backend == RENDERER_SOFTWARE || SDL_RenderTargetSupported(renderer->sdl);
+}
+
+static int roundToPixel(float x) {
+    return (int) SDL_floor(x + 0.5f);
+}
+
+// An SDL renderer keeps the origin as the top left of its viewport, stretched to still cover the whole target
+static void setRenderViewport(Renderer *renderer) {
+    if (renderer->origin.x == 0.f && renderer->origin.y == 0.f) {
+        SDL_RenderSetViewport(renderer->sdl, NULL);
+        return;
+    }
+    int width, height;
+    getRendererSize(renderer, &width, &height);
+    const int x = roundToPixel(renderer->origin.x);
+    const int y = roundToPixel(renderer->origin.y);
+    const SDL_Rect viewport = { x, y, width - x, height - y };
+    SDL_RenderSetViewport(renderer->sdl, &viewport);
+}
+
+//
+// Move what the *F calls and renderGeometry() draw by an offset on the target, a single translation
+// instead of a pass over their positions. The software backend adds it as it rounds them to pixels,
+// an SDL renderer takes it as its viewport to the whole pixel, which moves its other calls too,
+// so set it back to 0, 0 before drawing anything else.
+//
+void setRenderOrigin(Renderer *renderer, float x, float y) {
+    assert(renderer != NULL);
+
+    if (renderer->origin.x == x && renderer->origin.y == y) return;
+    renderer->origin = (SDL_FPoint) { x, y };
+    if (renderer->backend == RENDERER_SDL) {
+        setRenderViewport(renderer);
+    }
+}
+
+//
+// Draw into a texture made by createTargetTexture(), or back to the window or framebuffer with NULL
+//
+bool setRenderTarget(Renderer *renderer, struct Texture *target) {
+    assert(renderer != NULL);
+
+    if (renderer->backend == RENDERER_SDL) {
+        if (SDL_SetRenderTarget(renderer->sdl, (target != NULL) ? target->texture : NULL) != 0) return false;
+        // Switching targets resets the viewport the origin is kept in
+        if (renderer->origin.x != 0.f || renderer->origin.y != 0.f) {
+            setRenderViewport(renderer);
+        }
+    } else if (target != NULL && target->surface == NULL) {
+        return false;
+    }
+    renderer->target = target;
+    return true;
+}
+
+static SDL_Surface *getTargetSurface(const Renderer *renderer) {
+    return (renderer->target != NULL) ? renderer->target->surface : renderer->framebuffer;
+}
+
+void setRenderColor(Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a) {
+    assert(renderer != NULL);
+
+    renderer->color = (SDL_Color) { r, g, b, a };
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_SetRenderDrawColor(renderer->sdl, r, g, b, a);
+    }
+}
+
+static Uint32 getRasterColor(const Renderer *renderer) {
+    const SDL_Color color = renderer->color;
+    return ((Uint32) color.a << 24) | ((Uint32) color.r << 16) | ((Uint32) color.g << 8) | color.b;
+}
+
+void renderClear(Renderer *renderer) {
+    assert(renderer != NULL);
+
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderClear(renderer->sdl);
+    } else {
+        rasterClear(getTargetSurface(renderer), getRasterColor(renderer));
+    }
+    renderer->frame.drawCalls++;
+}
+
+void renderFillRects(Renderer *renderer, const SDL_Rect *rects, int count) {
+    assert(renderer != NULL);
+    if (count <= 0) return;
+
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderFillRects(renderer->sdl, rects, count);
+    } else {
+        rasterFillRects(getTargetSurface(renderer), rects, count, getRasterColor(renderer));
+    }
+    renderer->frame.drawCalls++;
+    renderer->frame.rects += count;
+}
+
+void renderDrawRects(Renderer *renderer, const SDL_Rect *rects, int count) {
+    assert(renderer != NULL);
+    if (count <= 0) return;
+
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderDrawRects(renderer->sdl, rects, count);
+    } else {
+        rasterDrawRects(getTargetSurface(renderer), rects, count, getRasterColor(renderer));
+    }
+    renderer->frame.drawCalls++;
+    renderer->frame.rects += count;
+}
+
+//
+// Draw count lines, from points[2 * i] to points[2 * i + 1]
+//
+void renderDrawLines(Renderer *renderer, const SDL_Point *points, int count) {
+    assert(renderer != NULL);
+    if (count <= 0) return;
+
+    if (renderer->backend == RENDERER_SDL) {
+        // SDL_RenderDrawLines joins its points up, so a call a line
+        for (int i = 0; i < count; ++i) {
+            SDL_RenderDrawLine(renderer->sdl, points[2 * i].x, points[2 * i].y, points[2 * i + 1].x, points[2 * i + 1].y);
+        }
+        renderer->frame.drawCalls += count;
+    } else {
+        rasterDrawLines(getTargetSurface(renderer), points, count, getRasterColor(renderer));
+        renderer->frame.drawCalls++;
+    }
+    renderer->frame.lines += count;
+}
+
+void renderCopy(Renderer *renderer, const struct Texture *texture, const SDL_Rect *src, const SDL_Rect *dest,
+                double angle, const SDL_Point *center, SDL_RendererFlip flip) {
+    assert(renderer != NULL && texture != NULL);
+
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderCopyEx(renderer->sdl, texture->texture, src, dest, angle, center, flip);
+    } else {
+        rasterCopy(getTargetSurface(renderer), texture->surface, src, dest, angle, center, flip);
+    }
+    renderer->frame.drawCalls++;
+    renderer->frame.copies++;
+}
+
+// Subpixel positions are rounded this many at a time when drawn with whole pixels
+#define ROUND_BATCH 256
+
+// What's added to positions as they're rounded, an SDL renderer's viewport moves them instead
+static SDL_FPoint getRoundingOrigin(const Renderer *renderer) {
+    return (renderer->backend == RENDERER_SOFTWARE) ? renderer->origin : (SDL_FPoint) { 0.f, 0.f };
+}
+
+// Rounds the edges rather than the size, so rects that meet still meet
+static SDL_Rect roundRect(const SDL_FRect *rect, SDL_FPoint origin) {
+    const float left = rect->x + origin.x;
+    const float top = rect->y + origin.y;
+    const int x = roundToPixel(left);
+    const int y = roundToPixel(top);
+    return (SDL_Rect) {
+            .x = x, .y = y,
+            .w = roundToPixel(left + rect->w) - x,
+            .h = roundToPixel(top + rect->h) - y
+    };
+}
+
+void renderFillRectsF(Renderer *renderer, const SDL_FRect *rects, int count) {
+    assert(renderer != NULL);
+
+#if RENDERER_FLOAT
+    if (renderer->backend == RENDERER_SDL) {
+        if (count <= 0) return;
+        SDL_RenderFillRectsF(renderer->sdl, rects, count);
+        renderer->frame.drawCalls++;
+        renderer->frame.rects += count;
+        return;
+    }
+#endif
+    const SDL_FPoint origin = getRoundingOrigin(renderer);
+    SDL_Rect rounded[ROUND_BATCH];
+    for (int first = 0; first < count; first += ROUND_BATCH) {
+        const int batch = MIN(count - first, ROUND_BATCH);
+        for (int i = 0; i < batch; ++i) {
+            rounded[i] = roundRect(&rects[first + i], origin);
+        }
+        renderFillRects(renderer, rounded, batch);
+    }
+}
+
+void renderDrawRectsF(Renderer *renderer, const SDL_FRect *rects, int count) {
+    assert(renderer != NULL);
+
+#if RENDERER_FLOAT
+    if (renderer->backend == RENDERER_SDL) {
+        if (count <= 0) return;
+        SDL_RenderDrawRectsF(renderer->sdl, rects, count);
+        renderer->frame.drawCalls++;
+        renderer->frame.rects += count;
+        return;
+    }
+#endif
+    const SDL_FPoint origin = getRoundingOrigin(renderer);
+    SDL_Rect rounded[ROUND_BATCH];
+    for (int first = 0; first < count; first += ROUND_BATCH) {
+        const int batch = MIN(count - first, ROUND_BATCH);
+        for (int i = 0; i < batch; ++i) {
+            rounded[i] = roundRect(&rects[first + i], origin);
+        }
+        renderDrawRects(renderer, rounded, batch);
+    }
+}
+
+//
+// Draw count lines, from points[2 * i] to points[2 * i + 1]
+//
+void renderDrawLinesF(Renderer *renderer, const SDL_FPoint *points, int count) {
+    assert(renderer != NULL);
+
+#if RENDERER_FLOAT
+    if (renderer->backend == RENDERER_SDL) {
+        if (count <= 0) return;
+        for (int i = 0; i < count; ++i) {
+            SDL_RenderDrawLineF(renderer->sdl, points[2 * i].x, points[2 * i].y, points[2 * i + 1].x, points[2 * i + 1].y);
+        }
+        renderer->frame.drawCalls += count;
+        renderer->frame.lines += count;
+        return;
+    }
+#endif
+    const SDL_FPoint origin = getRoundingOrigin(renderer);
+    SDL_Point rounded[2 * ROUND_BATCH];
+    for (int first = 0; first < count; first += ROUND_BATCH) {
+        const int batch = MIN(count - first, ROUND_BATCH);
+        for (int i = 0; i < 2 * batch; ++i) {
+            const SDL_FPoint point = points[2 * first + i];
+            rounded[i] = (SDL_Point) { roundToPixel(point.x + origin.x), roundToPixel(point.y + origin.y) };
+        }
+        renderDrawLines(renderer, rounded, batch);
+    }
+}
+
+void renderCopyF(Renderer *renderer, const struct Texture *texture, const SDL_Rect *src, const SDL_FRect *dest) {
+    assert(renderer != NULL && texture != NULL && dest != NULL);
+
+#if RENDERER_FLOAT
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderCopyF(renderer->sdl, texture->texture, src, dest);
+        renderer->frame.drawCalls++;
+        renderer->frame.copies++;
+        return;
+    }
+#endif
+    const SDL_Rect rounded = roundRect(dest, getRoundingOrigin(renderer));
+    renderCopy(renderer, texture, src, &rounded, 0.0, NULL, SDL_FLIP_NONE);
+}
+
+#if RENDERER_GEOMETRY
+//
+// Draw triangles with SDL_RenderGeometry, false if it can't so the caller can fall back
+//
+bool renderGeometry(Renderer *renderer, const struct Texture *texture, const SDL_Vertex *vertices, int numVertices,
+                    const int *indices, int numIndices) {
+    assert(renderer != NULL);
+
+    if (renderer->backend != RENDERER_SDL) return false;
+    SDL_Texture *sdlTexture = (texture != NULL) ? texture->texture : NULL;
+    if (SDL_RenderGeometry(renderer->sdl, sdlTexture, vertices, numVertices, indices, numIndices) != 0) return false;
+
+    renderer->frame.drawCalls++;
+    renderer->frame.triangles += numIndices / 3;
+    return true;
+}
+#endif
+
+void renderPresent(Renderer *renderer) {
+    assert(renderer != NULL);
+
+    if (renderer->backend == RENDERER_SDL) {
+        SDL_RenderPresent(renderer->sdl);
+    } else if (renderer->window != NULL) {
+        SDL_Surface *windowSurface = SDL_GetWindowSurface(renderer->window);
+        if (windowSurface != NULL) {
+            SDL_BlitSurface(renderer->framebuffer, NULL, windowSurface, NULL);
+            SDL_UpdateWindowSurface(renderer->window);
+        }
+    }
+
+    renderer->lastFrame = renderer->frame;
+    renderer->frame = (RendererStats) { 0 };
+    renderer->frames++;
+}
+
+void destroyRenderer(Renderer *renderer) {
+    if (renderer == NULL) return;
+    if (renderer->sdl != NULL) {
+        SDL_DestroyRenderer(renderer->sdl);
+    }
+    if (renderer->framebuffer != NULL) {
+        SDL_FreeSurface(renderer->framebuffer);
+    }
+    free(renderer);
+}
@@ -0,0 +1,84 @@
+#ifndef SERAPH_RENDERER_H
+#define SERAPH_RENDERER_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+struct Texture;
+
+// SDL_RenderGeometry is there to be tried, the software backend always declines it
+#define RENDERER_GEOMETRY SDL_VERSION_ATLEAST(2, 0, 18)
+
+// The *F calls take subpixel positions through SDL_Render*F, older SDLs and the
+// software backend round them to whole pixels
+#define RENDERER_FLOAT SDL_VERSION_ATLEAST(2, 0, 10)
+
+#if !RENDERER_FLOAT
+typedef struct SDL_FPoint {
+    float x;
+    float y;
+} SDL_FPoint;
+
+typedef struct SDL_FRect {
+    float x;
+    float y;
+    float w;
+    float h;
+} SDL_FRect;
+#endif
+
+typedef enum RendererBackend {
+    RENDERER_SDL,     // an SDL_Renderer, accelerated when it can be
+    RENDERER_SOFTWARE // raster.c into a framebuffer, the same bytes on any machine
+} RendererBackend;
+
+typedef struct RendererStats {
+    int drawCalls;
+    int lines;
+    int rects;
+    int copies;
+    int triangles;
+} RendererStats;
+
+// Draws through SDL, or rasterizes on the CPU into a framebuffer surface presented to the window if there is one
+typedef struct Renderer {
+    RendererBackend backend;
+    SDL_Window *window;        // NULL when headless
+    SDL_Renderer *sdl;         // RENDERER_SDL
+    SDL_Surface *framebuffer;  // RENDERER_SOFTWARE, ARGB8888
+    struct Texture *target;    // NULL for the window or framebuffer
+    SDL_Color color;
+    SDL_FPoint origin;         // the *F calls and geometry are drawn relative to it
+    // Counters, the frame being drawn and the last one presented
+    unsigned long frames;
+    RendererStats frame;
+    RendererStats lastFrame;
+} Renderer;
+
+Renderer *createRenderer(SDL_Window *window, Uint32 flags);
+Renderer *createSoftwareRenderer(SDL_Window *window, int width, int height);
+void resizeRenderer(Renderer *renderer, int width, int height);
+void getRendererSize(const Renderer *renderer, int *width, int *height);
+bool renderTargetSupported(const Renderer *renderer);
+bool setRenderTarget(Renderer *renderer, struct Texture *target);
+void setRenderColor(Renderer *renderer, Uint8 r, Uint8 g, Uint8 b, Uint8 a);
+void setRenderOrigin(Renderer *renderer, float x, float y);
+void renderClear(Renderer *renderer);
+void renderFillRects(Renderer *renderer, const SDL_Rect *rects, int count);
+void renderDrawRects(Renderer *renderer, const SDL_Rect *rects, int count);
+void renderDrawLines(Renderer *renderer, const SDL_Point *points, int count);
+void renderCopy(Renderer *renderer, const struct Texture *texture, const SDL_Rect *src, const SDL_Rect *dest,
+                double angle, const SDL_Point *center, SDL_RendererFlip flip);
+void renderFillRectsF(Renderer *renderer, const SDL_FRect *rects, int count);
+void renderDrawRectsF(Renderer *renderer, const SDL_FRect *rects, int count);
+void renderDrawLinesF(Renderer *renderer, const SDL_FPoint *points, int count);
+void renderCopyF(Renderer *renderer, const struct Texture *texture, const SDL_Rect *src, const SDL_FRect *dest);
+#if RENDERER_GEOMETRY
+bool renderGeometry(Renderer *renderer, const struct Texture *texture, const SDL_Vertex *vertices, int numVertices,
+                    const int *indices, int numIndices);
+#endif
+void renderPresent(Renderer *renderer);
+void destroyRenderer(Renderer *renderer);
+
+#endif //SERAPH_RENDERER_H
@@ -7,8 +7,8 @@ Sprite *createSprite(TextureRegion *keyframe) {
 
     int x = 0;
     int y = 0;
-    int w = keyframe->region.w;
-    int h = keyframe->region.h;
+    int w = keyframe->sourceW;
+    int h = keyframe->sourceH;
     return createSpriteWithBounds(keyframe, x, y, w, h);
 }
 
@@ -38,15 +38,33 @@ void rotateSprite(Sprite *sprite, float da) {
     sprite->angle += da;
 }
 
-void renderSprite(SDL_Renderer *renderer, const Sprite *sprite) {
+// Sprite sheets face left
+SDL_RendererFlip getFacingFlip(enum Facing facing) {
+    return (facing == LEFT) ? SDL_FLIP_NONE : SDL_FLIP_HORIZONTAL;
+}
+
+SDL_RendererFlip getSpriteFlip(const Sprite *sprite) {
+    assert(sprite != NULL);
+
+    return getFacingFlip(sprite->facing);
+}
+
+void renderSprite(Renderer *renderer, const Sprite *sprite) {
     assert(renderer != NULL && sprite != NULL);
 
-    SDL_Texture *texture        =  sprite->keyframe->texture->texture;
+    const Texture *texture      =  sprite->keyframe->texture;
     SDL_Rect *srcRect           = &sprite->keyframe->region;
-    const SDL_Rect *destRect    = &sprite->bounds;
+    const SDL_Rect *bounds      = &sprite->bounds;
     const double angle          =  sprite->angle;
-    const SDL_Point *origin     = NULL; // defaults to (w/2, h/2)
-    const SDL_RendererFlip flip = (sprite->facing == LEFT) ? SDL_FLIP_NONE : SDL_FLIP_HORIZONTAL;
+    const SDL_RendererFlip flip = getSpriteFlip(sprite);
+
+    // A trimmed keyframe covers part of the bounds, but still turns about their center
+    SDL_Rect destRect;
+    getTextureRegionDest(sprite->keyframe, bounds, flip, &destRect);
+    const SDL_Point origin = {
+            .x = bounds->x + bounds->w / 2 - destRect.x,
+            .y = bounds->y + bounds->h / 2 - destRect.y
+    };
 
-    SDL_RenderCopyEx(renderer, texture, srcRect, destRect, angle, origin, flip);
+    renderCopy(renderer, texture, srcRect, &destRect, angle, &origin, flip);
 }
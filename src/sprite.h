@@ -16,6 +16,8 @@ Sprite *createSprite(TextureRegion *keyframe);
 Sprite *createSpriteWithBounds(TextureRegion *keyframe, int x, int y, int w, int h);
 void translateSprite(Sprite *sprite, float x, float y);
 void rotateSprite(Sprite *sprite, float da);
-void renderSprite(SDL_Renderer *renderer, const Sprite *sprite);
+SDL_RendererFlip getFacingFlip(enum Facing facing);
+SDL_RendererFlip getSpriteFlip(const Sprite *sprite);
+void renderSprite(Renderer *renderer, const Sprite *sprite);
 
 #endif //SERAPH_SPRITE_H
@@ -0,0 +1,196 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "sprite_batch.h"
+#include "common.h"
+
+static void growSpriteBatch(SpriteBatch *batch, int maxItems) {
+    batch->items  = (SpriteBatchItem *) realloc(batch->items,  maxItems * sizeof(SpriteBatchItem));
+    batch->sorted = (SpriteBatchItem *) realloc(batch->sorted, maxItems * sizeof(SpriteBatchItem));
+#if SPRITE_BATCH_GEOMETRY
+    // A quad of two triangles per item, the indices are the same whichever sprites are drawn
+    batch->vertices = (SDL_Vertex *) realloc(batch->vertices, 4 * (size_t) maxItems * sizeof(SDL_Vertex));
+    batch->indices  = (int *) realloc(batch->indices, 6 * (size_t) maxItems * sizeof(int));
+    for (int i = batch->maxItems; i < maxItems; ++i) {
+        int *indices = &batch->indices[6 * i];
+        indices[0] = 4 * i;     indices[1] = 4 * i + 1; indices[2] = 4 * i + 2;
+        indices[3] = 4 * i + 2; indices[4] = 4 * i + 1; indices[5] = 4 * i + 3;
+    }
+#endif
+    batch->maxItems = maxItems;
+}
+
+SpriteBatch *createSpriteBatch(Renderer *renderer, int maxItems) {
+    assert(renderer != NULL && maxItems > 0);
+
+    SpriteBatch *batch = (SpriteBatch *) calloc(1, sizeof(SpriteBatch));
+    batch->renderer = renderer;
+    growSpriteBatch(batch, maxItems);
+    return batch;
+}
+
+void beginSpriteBatch(SpriteBatch *batch) {
+    assert(batch != NULL && !batch->drawing);
+
+    batch->drawing = true;
+    batch->numItems = 0;
+    batch->numTextures = 0;
+}
+
+//
+// Index of a texture in the batch, adding it if it's not been seen since begin
+//
+static int findBatchTexture(SpriteBatch *batch, const Texture *texture) {
+    // Runs of sprites from the same sheet are the common case
+    if (batch->numItems > 0 && batch->textures[batch->items[batch->numItems - 1].texture] == texture) {
+        return batch->items[batch->numItems - 1].texture;
+    }
+    for (int i = 0; i < batch->numTextures; ++i) {
+        if (batch->textures[i] == texture) return i;
+    }
+
+    if (batch->numTextures == batch->maxTextures) {
+        batch->maxTextures = MAX(2 * batch->maxTextures, 8);
+        batch->textures = (const Texture **) realloc(batch->textures, batch->maxTextures * sizeof(Texture *));
+        batch->textureCounts = (int *) realloc(batch->textureCounts, batch->maxTextures * sizeof(int));
+    }
+    batch->textures[batch->numTextures] = texture;
+    batch->textureCounts[batch->numTextures] = 0;
+    return batch->numTextures++;
+}
+
+void submitTextureRegion(SpriteBatch *batch, const TextureRegion *region, const SDL_Rect *dest,
+                         double angle, SDL_RendererFlip flip) {
+    assert(batch != NULL && batch->drawing && region != NULL && dest != NULL);
+
+    SDL_Rect trimmedDest;
+    getTextureRegionDest(region, dest, flip, &trimmedDest);
+
+    if (batch->numItems == batch->maxItems) {
+        growSpriteBatch(batch, 2 * batch->maxItems);
+    }
+
+    const int texture = findBatchTexture(batch, region->texture);
+    batch->textureCounts[texture]++;
+    batch->items[batch->numItems++] = (SpriteBatchItem) {
+            .texture = texture,
+            .src = region->region,
+            .dest = trimmedDest,
+            .center = { dest->x + dest->w / 2, dest->y + dest->h / 2 },
+            .angle = angle,
+            .flip = flip
+    };
+}
+
+void submitSprite(SpriteBatch *batch, const Sprite *sprite) {
+    assert(sprite != NULL);
+
+    submitTextureRegion(batch, sprite->keyframe, &sprite->bounds, sprite->angle, getSpriteFlip(sprite));
+}
+
+#if SPRITE_BATCH_GEOMETRY
+//
+// The quad for an item, rotated about its center and with its texture coordinates swapped to flip it
+//
+static void buildItemQuad(const SpriteBatchItem *item, const Texture *texture, SDL_Vertex *vertices) {
+    const SDL_Color color = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+    float u0 = (float) item->src.x / (float) texture->width;
+    float v0 = (float) item->src.y / (float) texture->height;
+    float u1 = (float) (item->src.x + item->src.w) / (float) texture->width;
+    float v1 = (float) (item->src.y + item->src.h) / (float) texture->height;
+    if (item->flip & SDL_FLIP_HORIZONTAL) { const float u = u0; u0 = u1; u1 = u; }
+    if (item->flip & SDL_FLIP_VERTICAL)   { const float v = v0; v0 = v1; v1 = v; }
+
+    const float centerX = (float) item->center.x;
+    const float centerY = (float) item->center.y;
+    const float left   = (float) item->dest.x - centerX;
+    const float top    = (float) item->dest.y - centerY;
+    const float right  = left + (float) item->dest.w;
+    const float bottom = top  + (float) item->dest.h;
+    float cosAngle = 1.f;
+    float sinAngle = 0.f;
+    if (item->angle != 0.0) {
+        const double radians = item->angle * M_PI / 180.0;
+        cosAngle = (float) SDL_cos(radians);
+        sinAngle = (float) SDL_sin(radians);
+    }
+
+    // Top left, bottom left, top right, bottom right, matching the index pattern
+    const float cornerX[4] = { left, left,   right, right  };
+    const float cornerY[4] = { top,  bottom, top,   bottom };
+    const float cornerU[4] = { u0, u0, u1, u1 };
+    const float cornerV[4] = { v0, v1, v0, v1 };
+    for (int i = 0; i < 4; ++i) {
+        vertices[i] = (SDL_Vertex) {
+                { centerX + cornerX[i] * cosAngle - cornerY[i] * sinAngle,
+                  centerY + cornerX[i] * sinAngle + cornerY[i] * cosAngle },
+                color,
+                { cornerU[i], cornerV[i] }
+        };
+    }
+}
+#endif
+
+//
+// Draw a run of sorted items that share a texture
+//
+static void drawBatchRun(SpriteBatch *batch, const Texture *texture, int first, int count) {
+    const SpriteBatchItem *items = &batch->sorted[first];
+
+#if SPRITE_BATCH_GEOMETRY
+    SDL_Vertex *vertices = &batch->vertices[4 * first];
+    for (int i = 0; i < count; ++i) {
+        buildItemQuad(&items[i], texture, &vertices[4 * i]);
+    }
+    if (renderGeometry(batch->renderer, texture, vertices, 4 * count, batch->indices, 6 * count)) {
+        batch->drawCalls++;
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; ++i) {
+        const SDL_Point center = { items[i].center.x - items[i].dest.x, items[i].center.y - items[i].dest.y };
+        renderCopy(batch->renderer, texture, &items[i].src, &items[i].dest, items[i].angle, &center, items[i].flip);
+    }
+    batch->drawCalls += count;
+}
+
+void endSpriteBatch(SpriteBatch *batch) {
+    assert(batch != NULL && batch->drawing);
+
+    // Counting sort by texture, keeping the submission order within each
+    int *next = batch->textureCounts;
+    int start = 0;
+    for (int t = 0; t < batch->numTextures; ++t) {
+        const int count = next[t];
+        next[t] = start;
+        start += count;
+    }
+    for (int i = 0; i < batch->numItems; ++i) {
+        batch->sorted[next[batch->items[i].texture]++] = batch->items[i];
+    }
+
+    // next[t] is now where texture t's run ends
+    batch->drawCalls = 0;
+    for (int t = 0; t < batch->numTextures; ++t) {
+        const int first = (t == 0) ? 0 : next[t - 1];
+        drawBatchRun(batch, batch->textures[t], first, next[t] - first);
+    }
+
+    batch->spritesDrawn = batch->numItems;
+    batch->drawing = false;
+}
+
+void destroySpriteBatch(SpriteBatch *batch) {
+    if (batch == NULL) return;
+    free(batch->items);
+    free(batch->sorted);
+    free(batch->textures);
+    free(batch->textureCounts);
+#if SPRITE_BATCH_GEOMETRY
+    free(batch->vertices);
+    free(batch->indices);
+#endif
+    free(batch);
+}
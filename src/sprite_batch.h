@@ -0,0 +1,56 @@
+#ifndef SERAPH_SPRITE_BATCH_H
+#define SERAPH_SPRITE_BATCH_H
+
+#include <stdbool.h>
+
+#include "SDL.h"
+
+#include "renderer.h"
+#include "sprite.h"
+#include "texture_region.h"
+
+// SDL_RenderGeometry draws all the sprites sharing a texture in one call,
+// older SDLs and the software renderer fall back to a copy per sprite, still grouped by texture
+#define SPRITE_BATCH_GEOMETRY RENDERER_GEOMETRY
+
+typedef struct SpriteBatchItem {
+    int texture; // index into the batch's textures
+    SDL_Rect src;
+    SDL_Rect dest;    // trimmed
+    SDL_Point center; // of the untrimmed bounds
+    double angle;     // degrees clockwise about the center, like SDL_RenderCopyEx
+    SDL_RendererFlip flip;
+} SpriteBatchItem;
+
+// Collects sprites between begin and end, then draws them grouped by texture.
+// Sprites sharing a texture keep the order they were submitted in, sprites on different textures don't.
+typedef struct SpriteBatch {
+    Renderer *renderer;
+    bool drawing;
+    int numItems;
+    int maxItems;
+    SpriteBatchItem *items;
+    SpriteBatchItem *sorted;
+    // The distinct textures submitted, in the order they were first seen
+    int numTextures;
+    int maxTextures;
+    const Texture **textures;
+    int *textureCounts;
+#if SPRITE_BATCH_GEOMETRY
+    SDL_Vertex *vertices; // four per item
+    int *indices;         // six per item
+#endif
+    // Counters, for the last batch
+    int spritesDrawn;
+    int drawCalls;
+} SpriteBatch;
+
+SpriteBatch *createSpriteBatch(Renderer *renderer, int maxItems);
+void beginSpriteBatch(SpriteBatch *batch);
+void submitSprite(SpriteBatch *batch, const Sprite *sprite);
+void submitTextureRegion(SpriteBatch *batch, const TextureRegion *region, const SDL_Rect *dest,
+                         double angle, SDL_RendererFlip flip);
+void endSpriteBatch(SpriteBatch *batch);
+void destroySpriteBatch(SpriteBatch *batch);
+
+#endif //SERAPH_SPRITE_BATCH_H
@@ -5,7 +5,7 @@
 
 #include "texture.h"
 
-Texture *createTextureFromFile(SDL_Renderer *renderer, const char *name, const char *path) {
+Texture *createTextureFromFile(Renderer *renderer, const char *name, const char *path) {
     assert(renderer != NULL && path != NULL);
 
     SDL_Surface *surface = IMG_Load(path);
@@ -21,7 +21,7 @@ Texture *createTextureFromFile(SDL_Renderer *renderer, const char *name, const c
     return texture;
 }
 
-Texture *createTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface, const char *name) {
+Texture *createTextureFromSurface(Renderer *renderer, SDL_Surface *surface, const char *name) {
     assert(renderer != NULL && surface != NULL);
     assert(surface->w >= 0 && surface->h >= 0);
 
@@ -30,8 +30,12 @@ Texture *createTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface,
     texture->path = NULL;
     texture->width  = (unsigned int) surface->w;
     texture->height = (unsigned int) surface->h;
-    texture->texture = SDL_CreateTextureFromSurface(renderer, surface);
-    if (texture->texture == NULL) {
+    if (renderer->backend == RENDERER_SDL) {
+        texture->texture = SDL_CreateTextureFromSurface(renderer->sdl, surface);
+    } else {
+        texture->surface = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+    }
+    if (texture->texture == NULL && texture->surface == NULL) {
         SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create texture from surface: %s", SDL_GetError());
         free(texture);
         exit(1);
@@ -39,18 +43,62 @@ Texture *createTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface,
     return texture;
 }
 
-void renderTexture(SDL_Renderer *renderer, const Texture *texture, const SDL_Rect *src, const SDL_Rect *dest) {
+//
+// A texture's details without its pixels, for images that are only drawn from an atlas
+//
+Texture *createTextureInfo(const char *name, const char *path, unsigned int width, unsigned int height) {
+    Texture *texture = (Texture *) calloc(1, sizeof(Texture));
+    texture->name = name;
+    texture->path = path;
+    texture->width  = width;
+    texture->height = height;
+    texture->texture = NULL;
+    texture->surface = NULL;
+    return texture;
+}
+
+//
+// A transparent texture to render into, NULL if the renderer can't make one
+//
+Texture *createTargetTexture(Renderer *renderer, int width, int height, const char *name) {
+    assert(renderer != NULL && width > 0 && height > 0);
+
+    Texture *texture = (Texture *) calloc(1, sizeof(Texture));
+    texture->name = name;
+    texture->path = NULL;
+    texture->width  = (unsigned int) width;
+    texture->height = (unsigned int) height;
+    if (renderer->backend == RENDERER_SDL) {
+        texture->texture = SDL_CreateTexture(renderer->sdl, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET, width, height);
+        if (texture->texture != NULL) {
+            SDL_SetTextureBlendMode(texture->texture, SDL_BLENDMODE_BLEND);
+        }
+    } else {
+        texture->surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    }
+    if (texture->texture == NULL && texture->surface == NULL) {
+        free(texture);
+        return NULL;
+    }
+    return texture;
+}
+
+void renderTexture(Renderer *renderer, const Texture *texture, const SDL_Rect *src, const SDL_Rect *dest) {
     assert(renderer != NULL && texture != NULL);
     if (src != NULL) {
         assert(src->x >= 0 && src->w <= texture->width
             && src->y >= 0 && src->h <= texture->height);
     }
-//    SDL_RenderCopy(renderer, texture->texture, src, dest);
-    SDL_RenderCopyEx(renderer, texture->texture, src, dest, 0.0, NULL, SDL_FLIP_HORIZONTAL);
+    renderCopy(renderer, texture, src, dest, 0.0, NULL, SDL_FLIP_HORIZONTAL);
 }
 
 void destroyTexture(Texture *texture) {
-    if (texture == NULL || texture->texture == NULL) return;
-    SDL_DestroyTexture(texture->texture);
+    if (texture == NULL) return;
+    if (texture->texture != NULL) {
+        SDL_DestroyTexture(texture->texture);
+    }
+    if (texture->surface != NULL) {
+        SDL_FreeSurface(texture->surface);
+    }
     free(texture);
 }
@@ -3,17 +3,22 @@
 
 #include "SDL.h"
 
+#include "renderer.h"
+
 typedef struct Texture {
     const char *name;
     const char *path;
     unsigned int width;
     unsigned int height;
-    SDL_Texture *texture;
+    SDL_Texture *texture;  // drawn through SDL
+    SDL_Surface *surface;  // drawn by the software renderer, ARGB8888
 } Texture;
 
-Texture *createTextureFromFile(SDL_Renderer *renderer, const char *path, const char *name);
-Texture *createTextureFromSurface(SDL_Renderer *renderer, SDL_Surface *surface, const char *name);
-void renderTexture(SDL_Renderer *renderer, const Texture *texture, const SDL_Rect *src, const SDL_Rect *dest);
+Texture *createTextureFromFile(Renderer *renderer, const char *name, const char *path);
+Texture *createTextureFromSurface(Renderer *renderer, SDL_Surface *surface, const char *name);
+Texture *createTextureInfo(const char *name, const char *path, unsigned int width, unsigned int height);
+Texture *createTargetTexture(Renderer *renderer, int width, int height, const char *name);
+void renderTexture(Renderer *renderer, const Texture *texture, const SDL_Rect *src, const SDL_Rect *dest);
 void destroyTexture(Texture *texture);
 
 #endif //SERAPH_TEXTURE_H
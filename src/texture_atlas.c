@@ -0,0 +1,145 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "texture_atlas.h"
+#include "common.h"
+
+//
+// Shrink a region to the bounds of its pixels that aren't fully transparent
+//
+static void trimAtlasRegion(AtlasRegion *region) {
+    SDL_Surface *source = region->source;
+    assert(source->format->format == SDL_PIXELFORMAT_ARGB8888);
+
+    // Keyframes are hand written, don't read past the image
+    const int x0 = MAX(region->src.x, 0);
+    const int y0 = MAX(region->src.y, 0);
+    const int x1 = MIN(region->src.x + region->src.w, source->w);
+    const int y1 = MIN(region->src.y + region->src.h, source->h);
+
+    int minX = x1, minY = y1, maxX = x0 - 1, maxY = y0 - 1;
+    if (SDL_MUSTLOCK(source)) SDL_LockSurface(source);
+    for (int y = y0; y < y1; ++y) {
+        const Uint32 *row = (const Uint32 *) ((const Uint8 *) source->pixels + y * source->pitch);
+        for (int x = x0; x < x1; ++x) {
+            if ((row[x] >> 24) == 0) continue;
+            minX = MIN(minX, x); maxX = MAX(maxX, x);
+            minY = MIN(minY, y); maxY = MAX(maxY, y);
+        }
+    }
+    if (SDL_MUSTLOCK(source)) SDL_UnlockSurface(source);
+
+    if (maxX < minX) {
+        // Nothing to see, keep a pixel so the region still has somewhere to be drawn from
+        region->trimmed = (SDL_Rect) { x0, y0, 1, 1 };
+    } else {
+        region->trimmed = (SDL_Rect) { minX, minY, maxX - minX + 1, maxY - minY + 1 };
+    }
+}
+
+static int compareRegionHeights(const void *a, const void *b) {
+    const AtlasRegion *regionA = *(const AtlasRegion **) a;
+    const AtlasRegion *regionB = *(const AtlasRegion **) b;
+    if (regionA->trimmed.h != regionB->trimmed.h) return regionB->trimmed.h - regionA->trimmed.h;
+    return regionB->trimmed.w - regionA->trimmed.w;
+}
+
+//
+// Trim the regions and pack them into as few pages as fit, filling in where each one went
+//
+TextureAtlas *createTextureAtlas(Renderer *renderer, AtlasRegion *regions, int numRegions) {
+    assert(renderer != NULL && (regions != NULL || numRegions == 0));
+
+    int maxWidth = TEXTURE_ATLAS_MAX_SIZE;
+    int maxHeight = TEXTURE_ATLAS_MAX_SIZE;
+    SDL_RendererInfo info;
+    if (renderer->backend == RENDERER_SDL && SDL_GetRendererInfo(renderer->sdl, &info) == 0) {
+        if (info.max_texture_width  > 0) maxWidth  = MIN(maxWidth,  info.max_texture_width);
+        if (info.max_texture_height > 0) maxHeight = MIN(maxHeight, info.max_texture_height);
+    }
+
+    AtlasRegion **sorted = (AtlasRegion **) calloc(MAX(numRegions, 1), sizeof(AtlasRegion *));
+    size_t sourcePixels = 0;
+    for (int i = 0; i < numRegions; ++i) {
+        trimAtlasRegion(&regions[i]);
+        sourcePixels += (size_t) regions[i].src.w * regions[i].src.h;
+        sorted[i] = &regions[i];
+    }
+    qsort(sorted, numRegions, sizeof(AtlasRegion *), compareRegionHeights);
+
+    // Shelves left to right, top to bottom, a new page when one fills up
+    int *pageWidths  = (int *) calloc(MAX(numRegions, 1), sizeof(int));
+    int *pageHeights = (int *) calloc(MAX(numRegions, 1), sizeof(int));
+    int page = 0, x = 0, y = 0, shelfHeight = 0;
+    for (int i = 0; i < numRegions; ++i) {
+        AtlasRegion *region = sorted[i];
+        // Padding only goes between regions, a region can run right up to the page's edges
+        const int w = region->trimmed.w;
+        const int h = region->trimmed.h;
+        if (w > maxWidth || h > maxHeight) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Region %dx%d is too big for a %dx%d texture atlas",
+                         w, h, maxWidth, maxHeight);
+            exit(1);
+        }
+
+        if (x + w > maxWidth) {
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        if (y + h > maxHeight) {
+            page++;
+            x = y = shelfHeight = 0;
+        }
+
+        region->page = page;
+        region->packed = (SDL_Rect) { x, y, w, h };
+        pageWidths[page] = MAX(pageWidths[page], x + w);
+        pageHeights[page] = MAX(pageHeights[page], y + h);
+        x += w + TEXTURE_ATLAS_PADDING;
+        shelfHeight = MAX(shelfHeight, h + TEXTURE_ATLAS_PADDING);
+    }
+
+    TextureAtlas *atlas = (TextureAtlas *) calloc(1, sizeof(TextureAtlas));
+    atlas->numPages = (numRegions > 0) ? (size_t) page + 1 : 0;
+    atlas->pages = (Texture **) calloc(MAX(atlas->numPages, 1), sizeof(Texture *));
+
+    size_t atlasPixels = 0;
+    for (int p = 0; p < (int) atlas->numPages; ++p) {
+        SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, pageWidths[p], pageHeights[p], 32, SDL_PIXELFORMAT_ARGB8888);
+        if (surface == NULL) {
+            SDL_LogError(SDL_LOG_CATEGORY_ERROR, "Failed to create texture atlas page: %s", SDL_GetError());
+            exit(1);
+        }
+        SDL_FillRect(surface, NULL, 0);
+
+        // Copy the pixels as they are, alpha included
+        for (int i = 0; i < numRegions; ++i) {
+            if (regions[i].page != p) continue;
+            SDL_Rect dest = regions[i].packed;
+            SDL_SetSurfaceBlendMode(regions[i].source, SDL_BLENDMODE_NONE);
+            SDL_BlitSurface(regions[i].source, &regions[i].trimmed, surface, &dest);
+        }
+
+        atlas->pages[p] = createTextureFromSurface(renderer, surface, "atlas");
+        atlasPixels += (size_t) surface->w * surface->h;
+        SDL_FreeSurface(surface);
+        SDL_LogDebug(SDL_LOG_CATEGORY_APPLICATION, "  Atlas page %d: %dx%d", p, pageWidths[p], pageHeights[p]);
+    }
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "  Packed %d regions into %lu atlas page(s), %lu pixels for %lu untrimmed",
+                numRegions, (unsigned long) atlas->numPages, (unsigned long) atlasPixels, (unsigned long) sourcePixels);
+
+    free(sorted);
+    free(pageWidths);
+    free(pageHeights);
+    return atlas;
+}
+
+void destroyTextureAtlas(TextureAtlas *atlas) {
+    if (atlas == NULL) return;
+    for (size_t i = 0; i < atlas->numPages; ++i) {
+        destroyTexture(atlas->pages[i]);
+    }
+    free(atlas->pages);
+    free(atlas);
+}
@@ -0,0 +1,31 @@
+#ifndef SERAPH_TEXTURE_ATLAS_H
+#define SERAPH_TEXTURE_ATLAS_H
+
+#include "SDL.h"
+
+#include "texture.h"
+
+// Pages are this wide, or the renderer's limit if smaller, and only as tall as what's packed into them
+#define TEXTURE_ATLAS_MAX_SIZE 1024
+// Transparent pixels between packed regions, so filtering doesn't bleed one into the next
+#define TEXTURE_ATLAS_PADDING 1
+
+// A region of a source image to pack. Its fully transparent borders are trimmed off first.
+typedef struct AtlasRegion {
+    SDL_Surface *source; // ARGB8888
+    SDL_Rect src;
+    SDL_Rect trimmed;    // in the source
+    int page;
+    SDL_Rect packed;     // in the page, the size of trimmed
+} AtlasRegion;
+
+// Textures packed from regions of other images, shelf by shelf tallest region first
+typedef struct TextureAtlas {
+    size_t numPages;
+    Texture **pages;
+} TextureAtlas;
+
+TextureAtlas *createTextureAtlas(Renderer *renderer, AtlasRegion *regions, int numRegions);
+void destroyTextureAtlas(TextureAtlas *atlas);
+
+#endif //SERAPH_TEXTURE_ATLAS_H
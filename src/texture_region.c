@@ -9,10 +9,45 @@ TextureRegion *createTextureRegion(Texture *texture, int x, int y, int w, int h)
     TextureRegion *textureRegion = (TextureRegion *) calloc(1, sizeof(TextureRegion));
     textureRegion->texture = texture;
     textureRegion->region = (SDL_Rect) { x, y, w, h };
+    textureRegion->offsetX = 0;
+    textureRegion->offsetY = 0;
+    textureRegion->sourceW = w;
+    textureRegion->sourceH = h;
     return textureRegion;
 }
 
-void renderTextureRegion(SDL_Renderer *renderer, TextureRegion *textureRegion, const SDL_Rect *dest) {
-    assert(textureRegion != NULL && textureRegion->texture != NULL && textureRegion->texture->texture != NULL);
+//
+// Where a trimmed region is drawn for its whole frame to fill bounds, the trim mirrors with the flip
+//
+void getTextureRegionDest(const TextureRegion *textureRegion, const SDL_Rect *bounds, SDL_RendererFlip flip, SDL_Rect *dest) {
+    assert(textureRegion != NULL && bounds != NULL && dest != NULL);
+
+    const int sourceW = textureRegion->sourceW;
+    const int sourceH = textureRegion->sourceH;
+    if (sourceW <= 0 || sourceH <= 0) {
+        *dest = *bounds;
+        return;
+    }
+
+    const SDL_Rect *region = &textureRegion->region;
+    const int offsetX = (flip & SDL_FLIP_HORIZONTAL) ? sourceW - textureRegion->offsetX - region->w : textureRegion->offsetX;
+    const int offsetY = (flip & SDL_FLIP_VERTICAL)   ? sourceH - textureRegion->offsetY - region->h : textureRegion->offsetY;
+    *dest = (SDL_Rect) {
+            .x = bounds->x + offsetX * bounds->w / sourceW,
+            .y = bounds->y + offsetY * bounds->h / sourceH,
+            .w = region->w * bounds->w / sourceW,
+            .h = region->h * bounds->h / sourceH
+    };
+}
+
+void renderTextureRegion(Renderer *renderer, TextureRegion *textureRegion, const SDL_Rect *dest) {
+    assert(textureRegion != NULL && textureRegion->texture != NULL);
+
+    // renderTexture() draws flipped horizontally
+    SDL_Rect trimmedDest;
+    if (dest != NULL) {
+        getTextureRegionDest(textureRegion, dest, SDL_FLIP_HORIZONTAL, &trimmedDest);
+        dest = &trimmedDest;
+    }
     renderTexture(renderer, textureRegion->texture, &textureRegion->region, dest);
 }
@@ -6,9 +6,15 @@
 typedef struct TextureRegion {
     Texture *texture;
     SDL_Rect region;
+    // Where the region sits in its untrimmed frame, atlases trim away fully transparent borders
+    int offsetX;
+    int offsetY;
+    int sourceW;
+    int sourceH;
 } TextureRegion;
 
 TextureRegion *createTextureRegion(Texture *texture, int x, int y, int w, int h);
-void renderTextureRegion(SDL_Renderer *renderer, TextureRegion *textureRegion, const SDL_Rect *dest);
+void getTextureRegionDest(const TextureRegion *textureRegion, const SDL_Rect *bounds, SDL_RendererFlip flip, SDL_Rect *dest);
+void renderTextureRegion(Renderer *renderer, TextureRegion *textureRegion, const SDL_Rect *dest);
 
 #endif //SERAPH_TEXTURE_REGION_H